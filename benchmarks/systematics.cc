@@ -0,0 +1,200 @@
+/**
+ * Compare the combination of the systematics done bin by bin on histograms, as TH1Plotter
+ * used to do it, with the kernels working on contiguous arrays of bin contents.
+ *
+ * Usage: benchmark-systematics [bins] [systematics] [processes] [repetitions]
+ **/
+
+#include <kernels.h>
+
+#include <TH1.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+    struct Shapes {
+        std::shared_ptr<TH1D> nominal;
+        std::shared_ptr<TH1D> up;
+        std::shared_ptr<TH1D> down;
+
+        std::vector<double> nominal_array;
+        std::vector<double> up_array;
+        std::vector<double> down_array;
+    };
+
+    std::vector<double> contents(const TH1& hist) {
+        std::vector<double> result(hist.GetNcells());
+        for (size_t i = 0; i < result.size(); i++)
+            result[i] = hist.GetBinContent(i);
+
+        return result;
+    }
+
+    /**
+     * The loops of TH1Plotter::computeSystematics, before the kernels
+     **/
+    double histograms(const std::vector<std::vector<Shapes>>& processes, TH1& syst_only, TH1& stat_only, TH1& stat_and_syst) {
+        size_t systematics = processes.front().size();
+        std::vector<std::vector<float>> combined(systematics, std::vector<float>(syst_only.GetNbinsX(), 0));
+
+        double summary = 0;
+        for (const auto& process: processes) {
+            for (size_t s = 0; s < systematics; s++) {
+                TH1* nominal = process[s].nominal.get();
+                TH1* up = process[s].up.get();
+                TH1* down = process[s].down.get();
+
+                float total_syst_error = 0;
+                for (uint32_t i = 1; i <= (uint32_t) syst_only.GetNbinsX(); i++) {
+                    float syst_error_up = std::abs(up->GetBinContent(i) - nominal->GetBinContent(i));
+                    float syst_error_down = std::abs(nominal->GetBinContent(i) - down->GetBinContent(i));
+                    float syst_error = std::max(syst_error_up, syst_error_down);
+
+                    total_syst_error += syst_error;
+                    combined[s][i - 1] += syst_error;
+                }
+
+                summary += total_syst_error;
+            }
+        }
+
+        for (auto& combined_systematics: combined) {
+            for (size_t i = 1; i <= (size_t) syst_only.GetNbinsX(); i++) {
+                float total_error = syst_only.GetBinError(i);
+                syst_only.SetBinError(i, std::sqrt(total_error * total_error + combined_systematics[i - 1] * combined_systematics[i - 1]));
+            }
+        }
+
+        for (uint32_t i = 1; i <= (uint32_t) syst_only.GetNbinsX(); i++) {
+            float syst_error = syst_only.GetBinError(i);
+            float stat_error = stat_only.GetBinError(i);
+            stat_and_syst.SetBinError(i, std::sqrt(syst_error * syst_error + stat_error * stat_error));
+        }
+
+        return summary;
+    }
+
+    /**
+     * The same combination with the kernels
+     **/
+    double arrays(const std::vector<std::vector<Shapes>>& processes, TH1& syst_only, TH1& stat_only, TH1& stat_and_syst) {
+        size_t systematics = processes.front().size();
+        size_t n_bins = syst_only.GetNbinsX();
+        std::vector<std::vector<double>> combined(systematics, std::vector<double>(n_bins, 0));
+
+        double summary = 0;
+        for (const auto& process: processes) {
+            for (size_t s = 0; s < systematics; s++) {
+                summary += plotIt::kernels::addEnvelope(process[s].nominal_array.data() + 1, process[s].up_array.data() + 1,
+                        process[s].down_array.data() + 1, combined[s].data(), n_bins);
+            }
+        }
+
+        std::vector<double> syst_errors(n_bins);
+        std::vector<double> stat_errors(n_bins);
+        for (size_t i = 1; i <= n_bins; i++) {
+            syst_errors[i - 1] = syst_only.GetBinError(i);
+            stat_errors[i - 1] = stat_only.GetBinError(i);
+        }
+
+        std::vector<double> squared_syst_errors(n_bins, 0);
+        plotIt::kernels::addSquares(syst_errors.data(), squared_syst_errors.data(), n_bins);
+        for (const auto& combined_systematics: combined)
+            plotIt::kernels::addSquares(combined_systematics.data(), squared_syst_errors.data(), n_bins);
+
+        plotIt::kernels::squareRoot(squared_syst_errors.data(), n_bins);
+
+        std::vector<double> stat_and_syst_errors(n_bins);
+        plotIt::kernels::quadrature(squared_syst_errors.data(), stat_errors.data(), stat_and_syst_errors.data(), n_bins);
+
+        for (size_t i = 1; i <= n_bins; i++) {
+            syst_only.SetBinError(i, squared_syst_errors[i - 1]);
+            stat_and_syst.SetBinError(i, stat_and_syst_errors[i - 1]);
+        }
+
+        return summary;
+    }
+
+    template <typename Function>
+    double time(Function function, size_t repetitions, double& result) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < repetitions; r++)
+            result = function();
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / repetitions;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t bins = (argc > 1) ? std::atoi(argv[1]) : 5000;
+    size_t systematics = (argc > 2) ? std::atoi(argv[2]) : 40;
+    size_t processes = (argc > 3) ? std::atoi(argv[3]) : 20;
+    size_t repetitions = (argc > 4) ? std::atoi(argv[4]) : 10;
+
+    if (! bins || ! systematics || ! processes || ! repetitions) {
+        std::cerr << "Usage: " << argv[0] << " [bins] [systematics] [processes] [repetitions]" << std::endl;
+        return 1;
+    }
+
+    TH1::AddDirectory(false);
+
+    std::mt19937 generator(42);
+    auto uniform = [&generator](double min, double max) {
+        return std::uniform_real_distribution<double>(min, max)(generator);
+    };
+
+    std::vector<std::vector<Shapes>> shapes(processes, std::vector<Shapes>(systematics));
+    for (auto& process: shapes) {
+        for (auto& s: process) {
+            s.nominal.reset(new TH1D("nominal", "", bins, 0, 1));
+            s.up.reset(new TH1D("up", "", bins, 0, 1));
+            s.down.reset(new TH1D("down", "", bins, 0, 1));
+
+            for (size_t i = 1; i <= bins; i++) {
+                double content = uniform(10, 100);
+                s.nominal->SetBinContent(i, content);
+                s.up->SetBinContent(i, content * uniform(1, 1.1));
+                s.down->SetBinContent(i, content * uniform(0.9, 1));
+            }
+
+            s.nominal_array = contents(*s.nominal);
+            s.up_array = contents(*s.up);
+            s.down_array = contents(*s.down);
+        }
+    }
+
+    TH1D stat_only("stat_only", "", bins, 0, 1);
+    stat_only.Sumw2();
+    for (size_t i = 1; i <= bins; i++)
+        stat_only.SetBinError(i, uniform(1, 10));
+
+    auto run = [&](double (*combine)(const std::vector<std::vector<Shapes>>&, TH1&, TH1&, TH1&)) {
+        TH1D syst_only(stat_only);
+        TH1D stat_and_syst(stat_only);
+        for (size_t i = 1; i <= bins; i++)
+            syst_only.SetBinError(i, 0);
+
+        return combine(shapes, syst_only, stat_only, stat_and_syst);
+    };
+
+    double reference = 0;
+    double result = 0;
+    double reference_time = time([&]() { return run(&histograms); }, repetitions, reference);
+    double kernels_time = time([&]() { return run(&arrays); }, repetitions, result);
+
+    std::cout << bins << " bins, " << systematics << " systematics, " << processes << " processes" << std::endl;
+    std::cout << "  histograms: " << reference_time << " ms" << std::endl;
+    std::cout << "  kernels:    " << kernels_time << " ms (x" << reference_time / kernels_time << ")" << std::endl;
+    std::cout << "  relative difference of the total: " << std::abs(result - reference) / reference << std::endl;
+
+    return 0;
+}
@@ -23,7 +23,11 @@ namespace plotIt {
 
         private:
             void setHistogramStyle(const File& file);
-            void addOverflow(TH1* h, Type type, const Plot& plot);
+            /**
+             * Move the content outside of the x axis range to the first and last bins, for `h`
+             * and for the shapes of `systematics`
+             **/
+            void addOverflow(TH1* h, Type type, const Plot& plot, std::vector<SystematicSet>* systematics = nullptr);
 
             Stack buildStack(int64_t index, bool sortByYields);
             Stacks buildStacks(bool sortByYields);
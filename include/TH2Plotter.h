@@ -0,0 +1,21 @@
+#pragma once
+
+#include <plotter.h>
+
+namespace plotIt {
+    /**
+     * Plotter for 2D histograms, as booked in tree mode for plots with a binning-y.
+     *
+     * The sum of the MC samples is drawn as a color map. Data, if any, is drawn on top
+     * as boxes. Signal samples and systematics are not shown.
+     **/
+    class TH2Plotter: public plotter {
+        public:
+            TH2Plotter(plotIt& plotIt):
+                plotter(plotIt) {
+                }
+
+            virtual boost::optional<Summary> plot(TCanvas& c, Plot& plot);
+            virtual bool supports(TObject& object);
+    };
+}
@@ -16,6 +16,12 @@ class CommandLineCfg {
         bool unblind = false;
         bool systematicsBreakdown = false;
         std::string era = "";
+        size_t threads = 1;
+        bool compile_expressions = false;
+        bool cache = false;
+        double preview_fraction = 1;
+        std::string pack_dir = "";
+        size_t max_open_files = 100;
 
     private:
         CommandLineCfg() = default;
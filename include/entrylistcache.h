@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace plotIt {
+
+    /**
+     * Persistent cache of the entries passing the tree-mode selections.
+     *
+     * For each (file, tree, selection), the list of the entries for which the selection
+     * is non-zero is stored in a file of the cache directory. The name of this file is
+     * a hash of the selection, the tree name, and the path, size and modification time
+     * of the input file, so that any change to the input or to the selection invalidates it.
+     **/
+    class EntryListCache {
+        public:
+            EntryListCache(const std::string& directory);
+
+            /**
+             * Return the key of the entry list of `selection` for the tree `tree_name` of `path`,
+             * or an empty string if `path` is not a local file.
+             **/
+            std::string key(const std::string& path, const std::string& tree_name, const std::string& selection) const;
+
+            /**
+             * Read the entry list identified by `key` into `entries`. Return false if it's not cached.
+             **/
+            bool load(const std::string& key, std::vector<int64_t>& entries) const;
+
+            void save(const std::string& key, const std::vector<int64_t>& entries) const;
+
+        private:
+            std::string path(const std::string& key) const;
+
+            std::string m_directory;
+    };
+}
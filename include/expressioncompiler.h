@@ -0,0 +1,74 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class TLeaf;
+class TTree;
+
+namespace plotIt {
+
+    /**
+     * A tree-mode expression translated to C++ and compiled into a native function.
+     *
+     * The function takes the values of the leaves listed in `inputs`, in the same order.
+     **/
+    struct CompiledExpression {
+        typedef double (*Function)(const double*);
+
+        Function function = nullptr;
+        std::vector<std::string> inputs;
+    };
+
+    /**
+     * Translate simple tree-mode expressions into C++ functions, and build them with ACLiC.
+     *
+     * Only expressions made of scalar numerical leaves, numbers, arithmetic and logical
+     * operators and common math functions are supported. Anything else is left to TTreeFormula.
+     * Math functions follow TTreeFormula, which returns 0 outside of their domain, and divisions
+     * are only supported by non-zero numbers, since TTreeFormula returns 0 when dividing by 0.
+     *
+     * The generated sources and libraries are named after a hash of the generated code,
+     * and are kept in the cache directory, so that they are built only once and reused
+     * by the next runs.
+     **/
+    class ExpressionCompiler {
+        public:
+            static ExpressionCompiler& get() {
+                static ExpressionCompiler instance;
+                return instance;
+            }
+
+            void setCacheDirectory(const std::string& directory);
+
+            /**
+             * Return the compiled version of `expression`, or nullptr if the expression is
+             * not supported, if one of its leaves is not a scalar numerical leaf of `tree`, or
+             * if the compilation failed.
+             *
+             * Thread-safe, but the first call for a given expression triggers the compilation,
+             * so it should preferably be done from the main thread.
+             **/
+            const CompiledExpression* compile(const std::string& expression, TTree& tree);
+
+            /**
+             * Return true if `leaf` can be read by a compiled expression
+             **/
+            static bool isScalarLeaf(const TLeaf* leaf);
+
+        private:
+            ExpressionCompiler() = default;
+
+            std::shared_ptr<CompiledExpression> build(const std::string& expression);
+
+            std::string m_cache_directory;
+
+            std::mutex m_mutex;
+
+            // Indexed by expression. Unsupported expressions are stored as nullptr
+            std::map<std::string, std::shared_ptr<CompiledExpression>> m_expressions;
+    };
+}
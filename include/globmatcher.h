@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace plotIt {
+
+    /**
+     * Match names against many glob patterns at once, case insensitively.
+     *
+     * Patterns are bucketed by their literal prefix when they are added, so that
+     * each name is only tested against the patterns which can possibly match it.
+     **/
+    class GlobMatcher {
+        public:
+            /**
+             * Add a pattern, with an optional exclude pattern. Return the index of the pattern.
+             **/
+            size_t add(const std::string& pattern, const std::string& exclude = "");
+
+            /**
+             * Fill `matches` with the indices of all the patterns matching `name`, and whose
+             * exclude pattern does not match `name`, in increasing order.
+             **/
+            void match(const std::string& name, std::vector<size_t>& matches) const;
+
+            size_t size() const { return m_patterns.size(); }
+
+        private:
+            struct Pattern {
+                std::string pattern;
+                std::string exclude;
+            };
+
+            std::vector<Pattern> m_patterns;
+
+            // Patterns indexed by their lowercase literal prefix, and the distinct lengths of these prefixes
+            std::unordered_map<std::string, std::vector<size_t>> m_buckets;
+            std::vector<size_t> m_prefix_lengths;
+    };
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class TH1;
+
+namespace plotIt {
+
+    struct Plot;
+
+    /**
+     * Persistent cache of the histograms filled in tree mode.
+     *
+     * The histograms filled from an input file are stored in a ROOT file of the cache directory,
+     * named after a hash of the path, size and modification time of the input file. Inside this file,
+     * each histogram is named after a hash of everything defining its content: tree name, draw
+     * and selection strings, and binning. Whitespaces outside of string literals are not part of
+     * the draw and selection strings hashed.
+     **/
+    class HistogramCache {
+        public:
+            HistogramCache(const std::string& directory);
+
+            /**
+             * Return the key of the histogram of `plot`, filled from the tree `tree_name`
+             **/
+            static std::string key(const Plot& plot, const std::string& tree_name);
+
+            /**
+             * Load the histograms identified by `keys`, filled from the input file `path`.
+             * Histograms not present in the cache are returned as nullptr.
+             **/
+            std::vector<std::shared_ptr<TH1>> load(const std::string& path, const std::vector<std::string>& keys) const;
+
+            /**
+             * Store the histograms `histograms`, filled from the input file `path`, under the keys `keys`
+             **/
+            void save(const std::string& path, const std::vector<std::string>& keys, const std::vector<TH1*>& histograms) const;
+
+        private:
+            /**
+             * Path of the cache file for the input file `path`. Empty if `path` is not a local file.
+             **/
+            std::string cacheFile(const std::string& path) const;
+
+            std::string m_directory;
+    };
+}
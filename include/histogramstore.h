@@ -0,0 +1,99 @@
+#pragma once
+
+#include <inputfile.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class TH1;
+
+namespace plotIt {
+
+    /**
+     * Read-only store of TH1F and TH1D histograms, as flat arrays in a memory-mapped file.
+     *
+     * A store is created from an input ROOT file by `plotIt-pack`. Each histogram is a record
+     * holding its axis, bin contents and sum of weights squared as contiguous arrays of doubles,
+     * followed by an index at the end of the file. Opening a store only reads this index,
+     * and reading a histogram never decompresses nor deserializes anything.
+     *
+     * The index lists all the keys of the input file, including the objects which are not packed,
+     * so that the input file never needs to be opened to list its content, or to find that an
+     * object does not exist.
+     *
+     * Stores are named after a hash of the path, size and modification time of the input file,
+     * so that a store is never used for an input file modified after it was packed.
+     **/
+    class HistogramStore {
+        public:
+            /**
+             * Map the store `path`. Return nullptr if the store does not exist or is not valid.
+             **/
+            static std::shared_ptr<HistogramStore> open(const std::string& path);
+
+            /**
+             * Path of the store of the input file `input` in the directory `directory`.
+             * Empty if `input` is not a local file.
+             **/
+            static std::string path(const std::string& directory, const std::string& input);
+
+            /**
+             * Pack all the TH1F and TH1D of the ROOT file `input` into the store `path`. Other classes,
+             * like TProfile, and histograms with bin labels are left out. Histograms are read back with
+             * their original class. Return the number of histograms packed, or -1 if `input` cannot be
+             * read or `path` cannot be written.
+             **/
+            static int64_t pack(const std::string& input, const std::string& path);
+
+            ~HistogramStore();
+
+            /**
+             * Return true if the histogram `name` is packed in the store
+             **/
+            bool contains(const std::string& name) const { return m_index.count(name) != 0; }
+
+            /**
+             * Return true if the input file has a key `name`, packed or not. `name` may end
+             * with ';<cycle>'.
+             **/
+            bool listed(const std::string& name) const { return m_keys.count(name) != 0; }
+
+            /**
+             * All the keys of the input file, as listed by InputFile::entries
+             **/
+            const std::vector<InputFile::Entry>& entries() const { return m_entries; }
+
+            /**
+             * Create a new histogram from the record `name`, of the class of the packed histogram.
+             * Return nullptr if the store does not contain `name`.
+             **/
+            std::shared_ptr<TH1> read(const std::string& name) const;
+
+            size_t size() const { return m_index.size(); }
+
+        private:
+            HistogramStore() = default;
+
+            /**
+             * Return a pointer to `count` elements of type T at `offset`, or nullptr
+             * if they are not entirely inside the mapped file
+             **/
+            template <typename T>
+            const T* at(uint64_t offset, uint64_t count) const;
+
+            const char* m_data = nullptr;
+            size_t m_size = 0;
+
+            // Offset of the record of each packed histogram, by path and by path;cycle
+            std::unordered_map<std::string, uint64_t> m_index;
+
+            // All the keys of the input file, by path and by path;cycle
+            std::unordered_set<std::string> m_keys;
+            std::vector<InputFile::Entry> m_entries;
+    };
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TDirectory;
+class TFile;
+class TKey;
+class TObject;
+
+namespace plotIt {
+
+    class HistogramStore;
+
+    /**
+     * An input ROOT file, with an index of all its keys.
+     *
+     * The keys of all the directories are indexed once, when the file is opened, so that
+     * looking up an object never needs to walk the directory structure again.
+     *
+     * If a packed store of the file is found in the --pack-dir folder, the histograms are read
+     * from the store, and the ROOT file is only opened to read objects the store lists but does
+     * not hold. Listing the keys and looking up missing objects are answered by the store.
+     **/
+    class InputFile {
+        public:
+            struct Entry {
+                std::string path; // Full path, with '/' separating directories
+                std::string class_name;
+                short cycle;
+            };
+
+            /**
+             * Open and index the file `path`, or its packed store. Return nullptr if neither
+             * can be opened.
+             **/
+            static std::shared_ptr<InputFile> open(const std::string& path);
+
+            ~InputFile();
+
+            /**
+             * The ROOT file, opened on first use if the histograms are read from a store.
+             * nullptr if the file cannot be opened.
+             **/
+            TFile* file();
+
+            /**
+             * Return the key of the object `path`, or nullptr if it does not exist. `path` may end
+             * with ';<cycle>' to select a cycle, the highest cycle is used otherwise.
+             * Opens the ROOT file if needed, use `contains` to only check for existence.
+             **/
+            TKey* key(const std::string& path);
+
+            /**
+             * Return true if the object `path` exists. Same syntax as `key`.
+             **/
+            bool contains(const std::string& path);
+
+            /**
+             * Read the object `path`. The returned object is owned by the caller only, no copy is kept
+             * by the file. Return nullptr if the object does not exist.
+             **/
+            std::shared_ptr<TObject> read(const std::string& path);
+
+            /**
+             * Read the objects `paths`, with nullptr for the objects which do not exist.
+             *
+             * The keys are read in the order of their position in the file, with a few large
+             * vectored reads instead of one small read per object, and are then deserialized.
+             **/
+            std::vector<std::shared_ptr<TObject>> read(const std::vector<std::string>& paths);
+
+            /**
+             * Records of objects read from the file, but not decompressed nor deserialized yet
+             **/
+            struct Batch {
+                struct Record {
+                    size_t index; // In the list of paths given to `fetch`
+                    TKey* key;
+                    size_t offset; // Of the record in `buffer`
+                };
+
+                std::vector<char> buffer;
+                std::vector<Record> records;
+            };
+
+            /**
+             * First half of `read`: read the records of the objects `paths`, in the order of the file.
+             * The objects which do not need deserialization, like those of the packed store, are directly
+             * set in `objects`, which must have the same size as `paths`.
+             **/
+            std::vector<Batch> fetch(const std::vector<std::string>& paths, std::vector<std::shared_ptr<TObject>>& objects);
+
+            /**
+             * Second half of `read`: decompress and deserialize the record `record` of `batch`.
+             * Not thread-safe: ROOT registers the histograms read to the directory of their key, so
+             * the records of a file must be deserialized by the thread using the file.
+             **/
+            static std::shared_ptr<TObject> deserialize(Batch& batch, size_t record);
+
+            /**
+             * All the keys of the file except directories, in the order of the directories listing.
+             * For each name, the highest cycle comes first.
+             **/
+            const std::vector<Entry>& entries();
+
+        private:
+            InputFile() = default;
+
+            void index(TDirectory* directory, const std::string& prefix);
+
+            /**
+             * Take the ownership of `object`, just read from the file
+             **/
+            static std::shared_ptr<TObject> own(TObject* object);
+
+            std::string m_path;
+
+            std::shared_ptr<HistogramStore> m_store;
+
+            std::unique_ptr<TFile> m_file;
+            bool m_opened = false;
+
+            std::vector<Entry> m_entries;
+
+            // Indexed by path, and by path;cycle
+            std::unordered_map<std::string, TKey*> m_keys;
+    };
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <inputfile.h>
+
+namespace plotIt {
+
+    /**
+     * Input files opened during the run, shared by all the loaders.
+     *
+     * At most `--max-open-files` files are kept open: when a new file is opened, the least
+     * recently used ones are closed, and are reopened transparently the next time they are needed.
+     * A file still used by a caller is only closed once the caller releases it.
+     *
+     * Thread-safe: used when loading the files in parallel
+     **/
+    class InputFilePool {
+        public:
+            static InputFilePool& get() {
+                static InputFilePool s_instance;
+
+                return s_instance;
+            }
+
+            /**
+             * Return the file `path`, opening it if needed. Return nullptr if the file cannot be opened.
+             **/
+            std::shared_ptr<InputFile> open(const std::string& path);
+
+            /**
+             * Return the sorted names of the '.root' files in `directory`. The directory is only listed
+             * the first time, all the input files of a directory sharing the listing.
+             **/
+            std::shared_ptr<const std::vector<std::string>> listing(const std::string& directory);
+
+            /**
+             * Close all the files
+             **/
+            void clear();
+
+            InputFilePool(InputFilePool const&) = delete;             // Copy construct
+            InputFilePool(InputFilePool&&) = delete;                  // Move construct
+            InputFilePool& operator=(InputFilePool const&) = delete;  // Copy assign
+            InputFilePool& operator=(InputFilePool &&) = delete;      // Move assign
+
+        protected:
+            InputFilePool() = default;
+
+        private:
+            typedef std::list<std::pair<std::string, std::shared_ptr<InputFile>>> FileList;
+
+            /**
+             * Remove the least recently used files until at most `maximum` are left, and return them.
+             * They are closed when the returned vector is destroyed, which must happen without the lock held.
+             **/
+            std::vector<std::shared_ptr<InputFile>> evict(size_t maximum);
+
+            std::mutex m_mutex;
+
+            // Most recently used first
+            FileList m_files;
+            std::unordered_map<std::string, FileList::iterator> m_index;
+
+            // Separate lock, so that listing a directory does not block the opening of files
+            std::mutex m_listings_mutex;
+            std::unordered_map<std::string, std::shared_ptr<const std::vector<std::string>>> m_listings;
+    };
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+namespace plotIt {
+
+    /**
+     * Loops over contiguous arrays of bin contents, used to combine the systematics.
+     *
+     * They are written so that the compiler can vectorize them: no branch, no aliasing
+     * between the output and the inputs, and no virtual call.
+     **/
+    namespace kernels {
+
+        /**
+         * Return the sum over the `n` bins of the envelope max(|up - nominal|, |nominal - down|)
+         **/
+        double envelope(const double* nominal, const double* up, const double* down, size_t n);
+
+        /**
+         * Add to `sum` the envelope max(|up - nominal|, |nominal - down|) of each of the `n` bins,
+         * and return the sum of the envelope over the bins
+         **/
+        double addEnvelope(const double* nominal, const double* up, const double* down, double* sum, size_t n);
+
+        /**
+         * Add to `sum` the square of each of the `n` values
+         **/
+        void addSquares(const double* values, double* sum, size_t n);
+
+        /**
+         * Replace each of the `n` values by its square root
+         **/
+        void squareRoot(double* values, size_t n);
+
+        /**
+         * Set `result` to the quadratic sum sqrt(a^2 + b^2) of each of the `n` values
+         **/
+        void quadrature(const double* a, const double* b, double* result, size_t n);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace plotIt {
+
+    /**
+     * Persistent list of the histograms contained in each input file, used to expand
+     * the glob plots without walking the directories of the files.
+     *
+     * Files are identified by their path, size and modification time: the content
+     * listed for a file which changed since is ignored.
+     **/
+    class Manifest {
+        public:
+            Manifest(const std::string& path);
+
+            /**
+             * Read the manifest from disk. A missing or unreadable manifest is treated as empty.
+             **/
+            void load();
+
+            /**
+             * Write the manifest to disk, if it changed since it was loaded. Entries of files
+             * deleted or modified since they were listed are dropped.
+             **/
+            void save();
+
+            /**
+             * Return the content of the file `path`, or nullptr if the manifest has no up-to-date
+             * content for it
+             **/
+            const std::vector<std::string>* content(const std::string& path) const;
+
+            void setContent(const std::string& path, const std::vector<std::string>& content);
+
+        private:
+            struct Entry {
+                std::string path;
+                std::vector<std::string> content;
+            };
+
+            std::string m_path;
+
+            // Indexed by a hash of the identity of the file
+            std::map<std::string, Entry> m_entries;
+            bool m_modified = false;
+    };
+}
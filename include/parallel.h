@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace plotIt {
+
+    /**
+     * Call `function(i)` for each i in [0, size), spreading the calls over at most `threads` threads.
+     *
+     * Everything runs in the calling thread if `threads` is 1, or if called from a function
+     * already running inside `parallel_for`. If any call throws, the first exception is
+     * re-thrown once all the threads are done.
+     **/
+    void parallel_for(size_t size, size_t threads, const std::function<void(size_t)>& function);
+}
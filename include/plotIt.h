@@ -93,8 +93,13 @@ namespace plotIt {
       bool yields(std::vector<Plot>::iterator plots_begin, std::vector<Plot>::iterator plots_end);
 
       bool expandFiles();
+      void resolveSystematics();
       bool expandObjects(File& file, std::vector<Plot>& plots);
-      bool loadAllObjects(File& file, std::vector<Plot>::const_iterator plots_begin, std::vector<Plot>::const_iterator plots_end);
+      bool listAllFilesContent(std::map<const File*, std::vector<std::string>>& contents);
+      bool loadAllObjects(std::vector<Plot>::const_iterator plots_begin, std::vector<Plot>::const_iterator plots_end);
+      void loadSystematics(File& file, std::vector<Plot>::const_iterator plots_begin, std::vector<Plot>::const_iterator plots_end);
+      bool needsSystematics(const Plot& plot) const;
+      bool loadAllTreeObjects(std::vector<Plot>::const_iterator plots_begin, std::vector<Plot>::const_iterator plots_end);
       bool loadObject(File& file, const Plot& plot);
 
       void fillLegend(TLegend& legend, const Plot& plot, bool with_uncertainties);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <commandlinecfg.h>
 #include <plotIt.h>
 #include <summary.h>
 
@@ -22,6 +23,21 @@ namespace plotIt {
       virtual bool supports(TObject& object) = 0;
 
     protected:
+      /**
+       * Factor to apply to the histograms of the non-data file `file`
+       **/
+      float getScaleFactor(const File& file) const {
+        float factor = file.cross_section * file.branching_ratio / file.generated_events;
+
+        if (! m_plotIt.getConfiguration().no_lumi_rescaling && ! file.era.empty())
+          factor *= m_plotIt.getConfiguration().luminosity.at(file.era);
+
+        if (! CommandLineCfg::get().ignore_scales)
+          factor *= m_plotIt.getConfiguration().scale * file.scale;
+
+        return factor;
+      }
+
       plotIt& m_plotIt;
 
   };
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <TH1Plotter.h>
+#include <TH2Plotter.h>
 #include <summary.h>
 
 #include <boost/optional.hpp>
@@ -9,6 +10,7 @@ namespace plotIt {
   static std::vector<std::shared_ptr<plotter>> s_plotters;
   void createPlotters(plotIt& plotIt) {
     s_plotters.push_back(std::make_shared<TH1Plotter>(plotIt));
+    s_plotters.push_back(std::make_shared<TH2Plotter>(plotIt));
   }
 
   boost::optional<Summary> plot(const File& file, TCanvas& c, Plot& plot) {
@@ -17,6 +19,8 @@ namespace plotIt {
         return plotter->plot(c, plot);
     }
 
+    std::cout << "Error: objects of class '" << file.object->ClassName() << "' of plot '" << plot.name << "' cannot be plotted" << std::endl;
+
     return boost::none;
   }
 }
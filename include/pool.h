@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include <TObject.h>
@@ -15,17 +16,37 @@ namespace plotIt {
             }
 
             void add(const std::shared_ptr<TObject>& object) {
+                std::lock_guard<std::mutex> lock(m_mutex);
                 m_temporaryObjects.push_back(object);
             }
 
+            /**
+             * Objects needed until the end of the current chunk of plots, like the loaded histograms.
+             * Thread-safe: used when loading the files in parallel
+             **/
+            void addChunk(const std::shared_ptr<TObject>& object) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_temporaryObjectsChunk.push_back(object);
+            }
+
+            /**
+             * Objects needed until the end of the run, like colors
+             **/
             void addRuntime(const std::shared_ptr<TObject>& object) {
+                std::lock_guard<std::mutex> lock(m_mutex);
                 m_temporaryObjectsRuntime.push_back(object);
             }
 
             void clear() {
+                std::lock_guard<std::mutex> lock(m_mutex);
                 m_temporaryObjects.clear();
             }
 
+            void clearChunk() {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_temporaryObjectsChunk.clear();
+            }
+
             TemporaryPool(TemporaryPool const&) = delete;             // Copy construct
             TemporaryPool(TemporaryPool&&) = delete;                  // Move construct
             TemporaryPool& operator=(TemporaryPool const&) = delete;  // Copy assign
@@ -35,7 +56,9 @@ namespace plotIt {
             TemporaryPool() = default;
 
         private:
+            std::mutex m_mutex;
             std::vector<std::shared_ptr<TObject>> m_temporaryObjects;
+            std::vector<std::shared_ptr<TObject>> m_temporaryObjectsChunk;
             std::vector<std::shared_ptr<TObject>> m_temporaryObjectsRuntime;
     };
 }
@@ -3,6 +3,7 @@
 #include <string>
 #include <memory>
 #include <regex>
+#include <vector>
 
 namespace YAML {
     class Node;
@@ -23,35 +24,95 @@ namespace plotIt {
     struct File;
     struct Systematic;
 
+    /**
+     * Content and binning of a nominal histogram, as read from the file.
+     *
+     * Taken when the systematic sets of a plot are created, because the plotter later scales, rebins
+     * and folds the nominal histogram in place. Shared by the sets of all the systematics of the plot.
+     **/
+    struct NominalShape {
+        NominalShape(const TH1& hist);
+
+        /**
+         * Return true if `hist` has the same bin edges as the nominal histogram
+         **/
+        bool sameBinning(const TH1& hist) const;
+
+        // Bin contents, including the underflow and overflow bins
+        std::shared_ptr<const std::vector<double>> contents;
+
+        int dimension;
+
+        // Low edges of the bins of each axis, followed by the upper edge of the last bin
+        std::vector<double> edges[3];
+    };
+
+    /**
+     * Shapes of a systematic for one plot of one file.
+     *
+     * Shapes are stored as plain arrays of bin contents, including the underflow and overflow bins,
+     * sharing the binning of the nominal histogram. Variations which are just copies of the nominal
+     * shape share its array.
+     *
+     * The shapes are only loaded by `load`, or by the first call to `update`, so that sets of plots
+     * not showing any uncertainty never read their variations. Loading compares the variations with
+     * the snapshot of the nominal histogram, never with the histogram itself, so it gives the same
+     * result whenever it happens.
+     **/
     struct SystematicSet {
-        std::shared_ptr<TObject> true_nominal_shape;
-        std::shared_ptr<TObject> true_up_shape;
-        std::shared_ptr<TObject> true_down_shape;
+        typedef std::vector<double> Shape;
+
+        // As loaded from the file, by `load`
+        std::shared_ptr<const Shape> true_nominal_shape;
+        std::shared_ptr<const Shape> true_up_shape;
+        std::shared_ptr<const Shape> true_down_shape;
 
-        std::shared_ptr<TObject> nominal_shape;
-        std::shared_ptr<TObject> up_shape;
-        std::shared_ptr<TObject> down_shape;
+        // Set by `update`, from the loaded shapes
+        Shape nominal_shape;
+        Shape up_shape;
+        Shape down_shape;
+
+        /**
+         * Load the shapes, if not already done
+         **/
+        void load();
 
+        /**
+         * Load the shapes if needed, and apply the systematic on them
+         **/
         void update();
 
         /**
-         * Assume objects are histograms and scale them by the specified factor
+         * Scale the shapes by the specified factor
          **/
         void scale(float factor);
 
         /**
-         * Assume objects are histograms and rebin them by the specified factor
+         * Merge the bins of the shapes by groups of `factor`, like TH1::Rebin
          **/
         void rebin(size_t factor);
 
+        /**
+         * Add the content of the bins before `first_bin` to `first_bin`, and of the bins after
+         * `last_bin` to `last_bin`, and clear them
+         **/
+        void addOverflow(size_t first_bin, size_t last_bin);
+
         std::string name() const;
         std::string prettyName() const;
 
         private:
         friend struct Systematic;
+        friend struct ShapeSystematic;
 
-        SystematicSet(Systematic&);
+        SystematicSet(Systematic&, std::shared_ptr<const NominalShape> nominal, File& file, const Plot& plot);
         Systematic* parent;
+
+        std::shared_ptr<const NominalShape> nominal;
+        File* file;
+        const Plot* plot;
+
+        bool loaded = false;
     };
 
     struct Systematic {
@@ -65,12 +126,18 @@ namespace plotIt {
          **/
         virtual void apply(SystematicSet&);
 
+        /**
+         * Create the set of `plot` for `file`, from the snapshot of its nominal histogram.
+         * Nothing is loaded until the set is used.
+         */
+        SystematicSet newSet(std::shared_ptr<const NominalShape> nominal, File& file, const Plot& plot);
+
         /**
          * Load from the file the necessary objects. Default implementation only
-         * clones the nominal histograms. Up and down variation are computed when
-         * apply is called.
+         * uses the content of the nominal histogram. Up and down variation are
+         * computed when apply is called.
          */
-        virtual SystematicSet newSet(TObject* nominal, File& file, const Plot& plot);
+        virtual void load(SystematicSet&, File& file, const Plot& plot);
     };
 
     struct ConstantSystematic: public Systematic {
@@ -100,7 +167,7 @@ namespace plotIt {
 
     struct ShapeSystematic: public Systematic {
         ShapeSystematic(const YAML::Node& node);
-        virtual SystematicSet newSet(TObject* nominal, File& file, const Plot& plot) override;
+        virtual void load(SystematicSet&, File& file, const Plot& plot) override;
     };
 
     class SystematicFactory {
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class TChain;
+class TH1;
+class TH2;
+class TLeaf;
+class TTreeFormula;
+
+namespace plotIt {
+
+    struct CompiledExpression;
+    struct Plot;
+
+    /**
+     * Fill the histograms of many plots with a single loop over a tree.
+     *
+     * All the histograms are booked first, and are then filled together
+     * when `fill` is called, so that each entry of the tree is read only once
+     * whatever the number of plots.
+     **/
+    class TreeFiller {
+        public:
+            TreeFiller(TChain& chain);
+            ~TreeFiller();
+
+            /**
+             * Book a new histogram named `name` for `plot`, using its draw and selection strings.
+             * The histogram is a TH2F if the plot has a binning along y, a TH1F otherwise.
+             * The histogram is empty until `fill` is called.
+             **/
+            std::shared_ptr<TH1> book(const Plot& plot, const std::string& name);
+
+            /**
+             * Loop over the entries [first, last) of the chain, and fill all the booked histograms.
+             * A negative `last` means up to the end of the chain.
+             *
+             * Return false if one of the expressions cannot be compiled
+             **/
+            bool fill(int64_t first = 0, int64_t last = -1);
+
+            /**
+             * Size of the tree cache, in bytes (-1: ROOT default), and number of entries used to
+             * learn the branches to cache. With 0 learn entries, the cache is filled with exactly
+             * the branches read by the expressions. Otherwise, the number of learn entries must
+             * be set with TTreeCache::SetLearnEntries, which applies to all the trees of the process.
+             **/
+            void setCacheOptions(int64_t size, int learn_entries);
+
+            /**
+             * I/O statistics of the last call to `fill`
+             **/
+            struct ReadStatistics {
+                int64_t read_calls = 0;
+                int64_t bytes_read = 0;
+
+                // Sum of the efficiencies of the tree caches of the files read, and number of caches
+                double cache_efficiency_sum = 0;
+                size_t caches = 0;
+            };
+
+            const ReadStatistics& statistics() const { return m_statistics; }
+
+            /**
+             * Split the entries [0, last) of the chain in at most `n` contiguous ranges [first, last) of
+             * similar sizes. Ranges boundaries are aligned on the clusters of the trees.
+             * A negative `last` means up to the end of the chain.
+             **/
+            static std::vector<std::pair<int64_t, int64_t>> split(TChain& chain, size_t n, int64_t last = -1);
+
+            /**
+             * Return the end of the smallest set of leading clusters of the chain covering
+             * at least `fraction` of its entries
+             **/
+            static int64_t previewEnd(TChain& chain, double fraction);
+
+            /**
+             * Split a 2D draw string 'y:x', following the convention of TTree::Draw, into its two expressions.
+             * Return false if `draw_string` is not a 2D expression.
+             **/
+            static bool splitDrawString(const std::string& draw_string, std::string& x, std::string& y);
+
+            /**
+             * Number of distinct selections of the booked plots, and their normalized expression.
+             * Selections are numbered in the order of booking.
+             **/
+            size_t selections() const { return m_selections.size(); }
+            const std::string& selection(size_t index) const;
+
+            /**
+             * Only evaluate the selection `index` for the entries in `entries`, sorted in increasing order.
+             * This must be the list of entries for which the selection is non-zero, typically recorded
+             * by a previous call to `fill`.
+             **/
+            void setEntryList(size_t index, std::shared_ptr<const std::vector<int64_t>> entries);
+
+            /**
+             * Entries for which the selection `index` was non-zero during the last call to `fill`.
+             * Only recorded for selections without an entry list.
+             **/
+            const std::vector<int64_t>& selectedEntries(size_t index) const;
+
+        private:
+            /**
+             * List the clusters [first, last) of all the trees of the chain, in chain entry numbers
+             **/
+            static std::vector<std::pair<int64_t, int64_t>> clusters(TChain& chain);
+
+            /**
+             * A draw or selection expression. It is evaluated by a compiled kernel
+             * if possible, by a TTreeFormula otherwise.
+             **/
+            struct Expression {
+                std::string string;
+
+                TTreeFormula* formula = nullptr;
+                const CompiledExpression* kernel = nullptr;
+
+                // Index in m_inputs of each argument of the kernel, and their values for the current entry
+                std::vector<size_t> inputs;
+                std::vector<double> values;
+            };
+
+            /**
+             * A leaf read by the compiled kernels. Its value is read at most once per entry,
+             * whatever the number of kernels using it.
+             **/
+            struct Input {
+                std::string name;
+                TLeaf* leaf = nullptr;
+
+                int64_t entry = -1;
+                double value = 0;
+            };
+
+            struct Booking {
+                std::shared_ptr<TH1> hist;
+                Expression draw;
+
+                // Only for 2D histograms
+                TH2* hist2d = nullptr;
+                Expression draw_y;
+            };
+
+            /**
+             * Plots sharing the same selection. The selection is evaluated only
+             * once per entry, before filling the histograms of all its plots.
+             **/
+            struct Selection {
+                // Normalized expression, identifying the selection
+                std::string key;
+                Expression expression;
+                std::vector<size_t> bookings;
+
+                // Value of each instance of the selection for the current entry
+                std::vector<double> weights;
+
+                std::shared_ptr<const std::vector<int64_t>> entry_list;
+                size_t next_listed = 0;
+
+                std::vector<int64_t> selected;
+            };
+
+            bool compile();
+            bool compile(Expression& expression, const std::string& name);
+            bool compileFormula(Expression& expression, const std::string& name);
+            void clearFormulas();
+
+            /**
+             * Resolve the leaves read by the kernels in the current tree of the chain
+             **/
+            bool updateInputs();
+
+            /**
+             * Evaluate with TTreeFormula the compiled expressions reading leaves which are
+             * not scalars in the current tree of the chain. Kernels are only checked against
+             * the first tree when they are built, and leaves can change type from file to file.
+             **/
+            bool checkKernels();
+
+            /**
+             * Prepare the evaluation of `expression` for the entry `entry` of the current tree,
+             * and return its number of instances
+             **/
+            int ndata(Expression& expression, int64_t entry);
+            bool multiple(const Expression& expression) const;
+            double eval(Expression& expression, int instance);
+
+            static void fillBooking(Booking& booking, double x, double y, double weight);
+
+            /**
+             * Only enable the branches read by the formulas, and restrict the tree cache to them
+             **/
+            void activateBranches();
+
+            /**
+             * Add the I/O statistics of the file of the current tree
+             **/
+            void collectStatistics();
+
+            TChain& m_chain;
+            std::vector<Booking> m_bookings;
+            std::vector<Selection> m_selections;
+            std::vector<Input> m_inputs;
+
+            int64_t m_cache_size = -1;
+            int m_cache_learn_entries = 0;
+
+            ReadStatistics m_statistics;
+    };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <boost/algorithm/string/join.hpp>
+#include <boost/dynamic_bitset.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
 
@@ -9,6 +10,7 @@
 #include <defines.h>
 #include <uuid.h>
 #include <systematics.h>
+#include <variationindex.h>
 
 #include <yaml-cpp/yaml.h>
 
@@ -156,13 +158,16 @@ namespace plotIt {
     std::vector<SystematicSet>* systematics;
     std::map<std::string, std::vector<SystematicSet>> systematics_cache;
 
+    // Bit i is set if the i-th systematic of the configuration applies to this file
+    boost::dynamic_bitset<> applicable_systematics;
+
+    // Friend files holding the shape variations, listed the first time they are needed
+    std::shared_ptr<VariationIndex> variations;
+
     int16_t order = std::numeric_limits<int16_t>::min();
 
     std::shared_ptr<TChain> chain;
 
-    std::shared_ptr<TFile> handle;
-    std::map<std::string, std::shared_ptr<TFile>> friend_handles;
-
     // Renaming
     std::vector<RenameOp> renaming_ops;
   };
@@ -304,8 +309,8 @@ namespace plotIt {
     // Blind range
     Range blinded_range;
 
-    uint16_t binning_x;  // Only used in tree mode
-    uint16_t binning_y;  // Only used in tree mode
+    uint16_t binning_x = 0;  // Only used in tree mode
+    uint16_t binning_y = 0;  // Only used in tree mode. If set, the plot is a 2D histogram and the draw string must be 'y:x'
 
     std::string draw_string;  // Only used in tree mode
     std::string selection_string;  // Only used in tree mode
@@ -452,6 +457,11 @@ namespace plotIt {
     std::string mode = "hist"; // "tree" or "hist"
     std::string tree_name;
 
+    // Tree mode I/O tuning
+    int64_t tree_cache_size = -1; // In bytes. -1: ROOT default
+    int tree_cache_learn_entries = 0; // 0: cache exactly the branches read by the expressions
+    bool tree_async_prefetch = false; // Read the next cluster in a background thread while the current one is processed
+
     ErrorsType errors_type = Poisson;
 
     float yields_table_stretch = 1.15;
@@ -181,6 +181,12 @@ namespace plotIt {
 
   float getPositiveMinimum(TObject* object);
 
+  /**
+   * Integral of all the bins of `hist`, including the underflow and overflow bins along
+   * each of its axes, and its statistical error
+   **/
+  double integralAndError(const TH1* hist, double& error);
+
   // replace all occurences of "old" in "s" by "rep"
   void replace_substr(std::string &s, const std::string &old, const std::string &rep);
 
@@ -212,4 +218,16 @@ namespace plotIt {
   TDirectory* getDirectory(TDirectoryFile* root, const boost::filesystem::path& directory, bool create = true);
 
     std::string applyRenaming(const std::vector<RenameOp>& ops, const std::string input);
+
+  // Stable hash of "data" (64-bit FNV-1a), as a 16 characters hexadecimal string. Suitable for cache file names
+  std::string fingerprint(const std::string& data);
+
+  // Identity of a local file, changing whenever the file is modified: canonical path, size and modification time.
+  // Empty if "path" is not a local file
+  std::string fileIdentity(const std::string& path);
+
+  // Remove the whitespaces outside of string literals from a tree-mode expression, so that expressions
+  // differing only by their formatting compare equal. A single space is kept where removing it would join
+  // two tokens, like in 'a - -b'. Only meant to be used as a key: the original expression is the one evaluated
+  std::string normalizeExpression(const std::string& expression);
 }
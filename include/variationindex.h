@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+namespace plotIt {
+
+    /**
+     * The friend files of an input file: the files '<stem>__<variation>.root' next to it,
+     * holding the shape variations of its objects under the same names.
+     *
+     * The index is built from the listing of the directory cached by InputFilePool, so that
+     * a directory is listed once for all its input files, and finding the friend file of a
+     * variation never touches the filesystem. Variations stored
+     * in the input file itself are found with the key index of InputFile.
+     **/
+    class VariationIndex {
+        public:
+            VariationIndex(const std::string& path);
+
+            /**
+             * Path of the friend file of the variation `postfix`, like '__jecup', or an empty
+             * string if there is none
+             **/
+            const std::string& friendFile(const std::string& postfix) const;
+
+        private:
+            // Indexed by postfix
+            std::unordered_map<std::string, std::string> m_friends;
+    };
+}
@@ -12,6 +12,7 @@
 #include <TGraphAsymmErrors.h>
 
 #include <commandlinecfg.h>
+#include <kernels.h>
 #include <pool.h>
 #include <utilities.h>
 
@@ -88,7 +89,8 @@ namespace plotIt {
     }
 
   bool TH1Plotter::supports(TObject& object) {
-    return object.InheritsFrom("TH1");
+    // 2D histograms are drawn by TH2Plotter
+    return object.InheritsFrom("TH1") && static_cast<TH1&>(object).GetDimension() == 1;
   }
 
   TH1Plotter::Stacks TH1Plotter::buildStacks(bool sortByYields) {
@@ -210,8 +212,10 @@ namespace plotIt {
 
   void TH1Plotter::computeSystematics(int64_t index, Stack& stack, Summary& summary) {
 
+      size_t n_bins = stack.syst_only->GetNbinsX();
+
       // Key is systematics name, value is the combined systematics value for each bin
-      std::map<std::string, std::vector<float>> combined_systematics_map;
+      std::map<std::string, std::vector<double>> combined_systematics_map;
 
       for ( auto& file: m_plotIt.getFiles([this,index] ( const File& f ) {
             return ( f.type != DATA ) && ( ! f.systematics->empty() )
@@ -220,45 +224,29 @@ namespace plotIt {
 
           for (auto& syst: *file.systematics) {
 
-              std::vector<float>* combined_systematics;
-              auto map_it = combined_systematics_map.find(syst.name());
-
-              if (map_it == combined_systematics_map.end()) {
-                  combined_systematics = &combined_systematics_map[syst.name()];
-                  combined_systematics->resize(stack.syst_only->GetNbinsX(), 0);
-              } else {
-
-                  combined_systematics = &map_it->second;
-              }
-
-              TH1* nominal_shape = static_cast<TH1*>(syst.nominal_shape.get());
-              TH1* up_shape = static_cast<TH1*>(syst.up_shape.get());
-              TH1* down_shape = static_cast<TH1*>(syst.down_shape.get());
+              std::vector<double>& combined_systematics = combined_systematics_map[syst.name()];
+              combined_systematics.resize(n_bins, 0);
 
-              if (! nominal_shape || ! up_shape || ! down_shape)
+              if (syst.nominal_shape.size() < n_bins + 2)
                   continue;
 
-              float total_syst_error = 0;
+              // Skip the underflow bin
+              const double* nominal_shape = syst.nominal_shape.data() + 1;
+              const double* up_shape = syst.up_shape.data() + 1;
+              const double* down_shape = syst.down_shape.data() + 1;
+
               // Systematics in each bin are fully correlated, as they come either from
               // a global variation, or for a shape variation. The total systematics error
               // is simply for sum of all errors in each bins
               //
               // However, we consider that different systematics in the same bin are totaly
               // uncorrelated. The total systematics errors is then the quadratic sum.
-              for (uint32_t i = 1; i <= (uint32_t) stack.syst_only->GetNbinsX(); i++) {
-                  float syst_error_up = std::abs(up_shape->GetBinContent(i) - nominal_shape->GetBinContent(i));
-                  float syst_error_down = std::abs(nominal_shape->GetBinContent(i) - down_shape->GetBinContent(i));
-
-                  // FIXME: Add support for asymetric errors
-                  float syst_error = std::max(syst_error_up, syst_error_down);
-
-                  total_syst_error += syst_error;
-
-                  // Only propagate uncertainties for MC, not signal
-                  if (file.type == MC)
-                      (*combined_systematics)[i - 1] += syst_error;
-              }
-
+              //
+              // Only propagate uncertainties for MC, not signal
+              // FIXME: Add support for asymetric errors
+              double total_syst_error = (file.type == MC) ?
+                  kernels::addEnvelope(nominal_shape, up_shape, down_shape, combined_systematics.data(), n_bins) :
+                  kernels::envelope(nominal_shape, up_shape, down_shape, n_bins);
 
               SummaryItem summary_item;
               summary_item.process_id = file.id;
@@ -269,20 +257,30 @@ namespace plotIt {
           }
       }
 
+      std::vector<double> syst_errors(n_bins);
+      std::vector<double> stat_errors(n_bins);
+      for (size_t i = 1; i <= n_bins; i++) {
+          syst_errors[i - 1] = stack.syst_only->GetBinError(i);
+          stat_errors[i - 1] = stack.stat_only->GetBinError(i);
+      }
+
       // Combine all systematics in one
       // Consider that all the systematics are not correlated
-      for (auto& combined_systematics: combined_systematics_map) {
-          for (size_t i = 1; i <= (size_t) stack.syst_only->GetNbinsX(); i++) {
-              float total_error = stack.syst_only->GetBinError(i);
-              stack.syst_only->SetBinError(i, std::sqrt(total_error * total_error + combined_systematics.second[i - 1] * combined_systematics.second[i - 1]));
-          }
-      }
+      std::vector<double> squared_syst_errors(n_bins, 0);
+      kernels::addSquares(syst_errors.data(), squared_syst_errors.data(), n_bins);
+      for (const auto& combined_systematics: combined_systematics_map)
+          kernels::addSquares(combined_systematics.second.data(), squared_syst_errors.data(), n_bins);
+
+      kernels::squareRoot(squared_syst_errors.data(), n_bins);
+      syst_errors.swap(squared_syst_errors);
 
       // Propagate syst errors to the stat + syst histogram
-      for (uint32_t i = 1; i <= (uint32_t) stack.syst_only->GetNbinsX(); i++) {
-          float syst_error = stack.syst_only->GetBinError(i);
-          float stat_error = stack.stat_only->GetBinError(i);
-          stack.stat_and_syst->SetBinError(i, std::sqrt(syst_error * syst_error + stat_error * stat_error));
+      std::vector<double> stat_and_syst_errors(n_bins);
+      kernels::quadrature(syst_errors.data(), stat_errors.data(), stat_and_syst_errors.data(), n_bins);
+
+      for (size_t i = 1; i <= n_bins; i++) {
+          stack.syst_only->SetBinError(i, syst_errors[i - 1]);
+          stack.stat_and_syst->SetBinError(i, stat_and_syst_errors[i - 1]);
       }
   }
 
@@ -296,6 +294,9 @@ namespace plotIt {
 
     Summary global_summary;
 
+    // The systematics are only used for the error bands
+    bool with_systematics = plot.show_errors && ! plot.normalized;
+
     // Rescale and style histograms
     for (auto& file : m_plotIt.getFiles()) {
       setHistogramStyle(file);
@@ -305,17 +306,7 @@ namespace plotIt {
       if (file.type != DATA) {
         plot.is_rescaled = true;
 
-        float factor = file.cross_section * file.branching_ratio / file.generated_events;
-
-        if (! m_plotIt.getConfiguration().no_lumi_rescaling) {
-	      if (! file.era.empty()) {
-          	factor *= m_plotIt.getConfiguration().luminosity.at(file.era);
-	    	}
-		}
-
-        if (! CommandLineCfg::get().ignore_scales) {
-          factor *= m_plotIt.getConfiguration().scale * file.scale;
-        }
+        float factor = getScaleFactor(file);
 
         h->Scale(factor);
         SummaryItem summary;
@@ -349,12 +340,14 @@ namespace plotIt {
 
         global_summary.add(file.type, summary);
 
-        // Update all systematics for this file
-        for (auto& syst: *file.systematics) {
-          syst.update();
+        // Update all systematics for this file. Their shapes are only loaded if they are shown
+        if (with_systematics) {
+          for (auto& syst: *file.systematics) {
+            syst.update();
 
-          syst.scale(factor);
-          syst.rebin(plot.rebin);
+            syst.scale(factor);
+            syst.rebin(plot.rebin);
+          }
         }
 
       } else {
@@ -369,15 +362,7 @@ namespace plotIt {
 
       // Add overflow to first and last bin if requested
       if (plot.show_overflow) {
-        addOverflow(h, file.type, plot);
-
-        if (file.type != DATA) {
-            for (auto& syst: *file.systematics) {
-                addOverflow(static_cast<TH1*>(syst.nominal_shape.get()), file.type, plot);
-                addOverflow(static_cast<TH1*>(syst.up_shape.get()), file.type, plot);
-                addOverflow(static_cast<TH1*>(syst.down_shape.get()), file.type, plot);
-            }
-        }
+        addOverflow(h, file.type, plot, (with_systematics && file.type != DATA) ? file.systematics : nullptr);
       }
     }
 
@@ -1010,7 +995,7 @@ namespace plotIt {
       h->SetLineColor(style->fill_color);
   }
 
-  void TH1Plotter::addOverflow(TH1* h, Type type, const Plot& plot) {
+  void TH1Plotter::addOverflow(TH1* h, Type type, const Plot& plot, std::vector<SystematicSet>* systematics) {
 
     if (!h || !h->GetEntries())
         return;
@@ -1068,5 +1053,11 @@ namespace plotIt {
     h->SetBinContent(last_bin, last_bin_content + overflow);
     if (type != DATA)
         h->SetBinError(last_bin, sqrt(overflow_sumw2 + last_bin_sumw2));
+
+    // The shapes of the systematics have the same binning
+    if (systematics) {
+      for (auto& syst: *systematics)
+        syst.addOverflow(first_bin, last_bin);
+    }
   }
 }
@@ -0,0 +1,98 @@
+#include <TH2Plotter.h>
+
+#include <TCanvas.h>
+#include <TH2.h>
+
+#include <pool.h>
+#include <utilities.h>
+
+namespace plotIt {
+
+  bool TH2Plotter::supports(TObject& object) {
+    return object.InheritsFrom("TH2");
+  }
+
+  boost::optional<Summary> TH2Plotter::plot(TCanvas& c, Plot& plot) {
+    c.cd();
+
+    // Room for the color palette
+    c.SetRightMargin(c.GetLeftMargin());
+
+    Summary global_summary;
+
+    std::shared_ptr<TH2> h_mc;
+    std::shared_ptr<TH2> h_data;
+
+    for (auto& file: m_plotIt.getFiles()) {
+      TH2* h = dynamic_cast<TH2*>(file.object);
+      if (! h) {
+        std::cout << "Error: object of plot '" << plot.name << "' in file '" << file.path << "' is not a 2D histogram" << std::endl;
+        return boost::none;
+      }
+
+      SummaryItem summary;
+      summary.name = file.pretty_name;
+      summary.process_id = file.id;
+
+      if (file.type != DATA) {
+        plot.is_rescaled = true;
+        h->Scale(getScaleFactor(file));
+
+        double error = 0;
+        summary.events = h->IntegralAndError(1, h->GetNbinsX(), 1, h->GetNbinsY(), error);
+        summary.events_uncertainty = error;
+      } else {
+        summary.events = h->Integral();
+      }
+
+      global_summary.add(file.type, summary);
+
+      if (plot.rebin > 1)
+        h->RebinX(plot.rebin);
+
+      if (file.type == SIGNAL)
+        continue;
+
+      std::shared_ptr<TH2>& sum = (file.type == DATA) ? h_data : h_mc;
+      if (! sum) {
+        sum.reset(static_cast<TH2*>(h->Clone()));
+        sum->SetDirectory(nullptr);
+      } else {
+        sum->Add(h);
+      }
+    }
+
+    if (plot.no_data)
+      h_data.reset();
+
+    std::shared_ptr<TH2> frame = h_mc ? h_mc : h_data;
+    if (! frame) {
+      std::cout << "Error: no MC nor data histogram for plot '" << plot.name << "'" << std::endl;
+      return boost::none;
+    }
+
+    frame->Draw("COLZ");
+    TemporaryPool::get().add(frame);
+
+    if (h_data && h_data != frame) {
+      h_data->Draw("BOX same");
+      TemporaryPool::get().add(h_data);
+    }
+
+    auto x_axis_range = plot.log_x ? plot.log_x_axis_range : plot.x_axis_range;
+    auto y_axis_range = plot.log_y ? plot.log_y_axis_range : plot.y_axis_range;
+
+    setDefaultStyle(frame.get(), plot, 1.);
+    setRange(frame.get(), x_axis_range, y_axis_range);
+    hideTicks(frame.get(), plot.x_axis_hide_ticks, plot.y_axis_hide_ticks);
+
+    // The y axis is a variable, not a number of events per bin
+    frame->GetXaxis()->SetTitle(plot.x_axis.c_str());
+    frame->GetYaxis()->SetTitle(plot.y_axis.c_str());
+
+    gPad->Modified();
+    gPad->Update();
+
+    return global_summary;
+  }
+}
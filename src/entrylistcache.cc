@@ -0,0 +1,95 @@
+#include <entrylistcache.h>
+#include <utilities.h>
+#include <uuid.h>
+
+#include <fstream>
+#include <iostream>
+
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace plotIt {
+
+    namespace {
+        // Bump when the format of the files changes
+        const uint32_t VERSION = 1;
+    }
+
+    EntryListCache::EntryListCache(const std::string& directory):
+        m_directory(directory) {
+
+    }
+
+    std::string EntryListCache::key(const std::string& path, const std::string& tree_name, const std::string& selection) const {
+        std::string identity = fileIdentity(path);
+        if (identity.empty())
+            return "";
+
+        return fingerprint(identity + '\n' + tree_name + '\n' + selection);
+    }
+
+    std::string EntryListCache::path(const std::string& key) const {
+        return (fs::path(m_directory) / (key + ".entries")).string();
+    }
+
+    bool EntryListCache::load(const std::string& key, std::vector<int64_t>& entries) const {
+        if (key.empty())
+            return false;
+
+        std::ifstream in(path(key), std::ios::binary);
+        if (! in)
+            return false;
+
+        uint32_t version = 0;
+        uint64_t size = 0;
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        in.read(reinterpret_cast<char*>(&size), sizeof(size));
+        if (! in || version != VERSION)
+            return false;
+
+        entries.resize(size);
+        in.read(reinterpret_cast<char*>(entries.data()), size * sizeof(int64_t));
+
+        if (! in) {
+            entries.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+    void EntryListCache::save(const std::string& key, const std::vector<int64_t>& entries) const {
+        if (key.empty())
+            return;
+
+        boost::system::error_code error;
+        fs::create_directories(m_directory, error);
+
+        // Write to a temporary file first, so that concurrent runs never read a partial list
+        std::string target = path(key);
+        std::string temporary = target + "." + get_uuid();
+
+        {
+            std::ofstream out(temporary, std::ios::binary);
+
+            uint32_t version = VERSION;
+            uint64_t size = entries.size();
+            out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+            out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+            out.write(reinterpret_cast<const char*>(entries.data()), size * sizeof(int64_t));
+
+            if (! out) {
+                std::cout << "Warning: failed to write entry list cache '" << target << "'" << std::endl;
+                fs::remove(temporary, error);
+                return;
+            }
+        }
+
+        fs::rename(temporary, target, error);
+        if (error) {
+            std::cout << "Warning: failed to write entry list cache '" << target << "'" << std::endl;
+            fs::remove(temporary, error);
+        }
+    }
+}
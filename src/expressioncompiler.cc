@@ -0,0 +1,283 @@
+#include <expressioncompiler.h>
+#include <utilities.h>
+
+#include <TLeaf.h>
+#include <TSystem.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace plotIt {
+
+    namespace {
+
+        // Functions known by TTreeFormula, and their C++ equivalent. Functions which TTreeFormula guards
+        // against invalid arguments use the helpers of PRELUDE, with the same semantics
+        const std::map<std::string, std::string> FUNCTIONS = {
+            {"sqrt", "ttreeformula::sqrt"}, {"abs", "std::abs"}, {"fabs", "std::abs"},
+            {"exp", "ttreeformula::exp"}, {"log", "ttreeformula::log"}, {"log10", "ttreeformula::log10"}, {"pow", "std::pow"},
+            {"sin", "std::sin"}, {"cos", "std::cos"}, {"tan", "std::tan"},
+            {"asin", "ttreeformula::asin"}, {"acos", "ttreeformula::acos"}, {"atan", "std::atan"}, {"atan2", "std::atan2"},
+            {"sinh", "std::sinh"}, {"cosh", "std::cosh"}, {"tanh", "std::tanh"},
+            {"TMath::Abs", "TMath::Abs"}, {"TMath::Sqrt", "TMath::Sqrt"}, {"TMath::Exp", "TMath::Exp"},
+            {"TMath::Log", "TMath::Log"}, {"TMath::Log10", "TMath::Log10"}, {"TMath::Power", "TMath::Power"},
+            {"TMath::Sin", "TMath::Sin"}, {"TMath::Cos", "TMath::Cos"}, {"TMath::Tan", "TMath::Tan"},
+            {"TMath::ATan2", "TMath::ATan2"}, {"TMath::Min", "TMath::Min"}, {"TMath::Max", "TMath::Max"},
+            {"TMath::Pi", "TMath::Pi"}
+        };
+
+        /**
+         * Built-in functions of TTreeFormula (TFormula v5) returning 0 instead of NaN or inf
+         * for arguments outside of their domain. TMath functions are called as is by TTreeFormula.
+         **/
+        const std::string PRELUDE = R"(#include <algorithm>
+#include <cmath>
+#include <TMath.h>
+
+namespace ttreeformula {
+    inline double sqrt(double x) { return std::sqrt(std::abs(x)); }
+    inline double log(double x) { return (x > 0) ? std::log(x) : 0; }
+    inline double log10(double x) { return (x > 0) ? std::log10(x) : 0; }
+    inline double asin(double x) { return (std::abs(x) > 1) ? 0 : std::asin(x); }
+    inline double acos(double x) { return (std::abs(x) > 1) ? 0 : std::acos(x); }
+    inline double exp(double x) { return (x < -700) ? 0 : std::exp(std::min(x, 709.)); }
+}
+)";
+
+        const std::set<std::string> LEAF_TYPES = {
+            "Bool_t", "UChar_t", "Short_t", "UShort_t", "Int_t", "UInt_t",
+            "Long_t", "ULong_t", "Long64_t", "ULong64_t", "Float_t", "Double_t"
+        };
+
+        bool isIdentifier(char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+        }
+
+        /**
+         * Translate `expression` into a C++ expression, where each leaf is replaced by
+         * an element of the `in` array. Return false if the expression uses a syntax
+         * not supported by the translation.
+         **/
+        bool translate(const std::string& expression, std::string& code, std::vector<std::string>& inputs) {
+            size_t n = expression.size();
+            size_t i = 0;
+
+            while (i < n) {
+                char c = expression[i];
+
+                if (std::isspace(static_cast<unsigned char>(c))) {
+                    i++;
+                    continue;
+                }
+
+                // Numbers. TTreeFormula computes everything with doubles, make sure integer literals are too
+                if (std::isdigit(static_cast<unsigned char>(c)) || (c == '.' && i + 1 < n && std::isdigit(static_cast<unsigned char>(expression[i + 1])))) {
+                    size_t start = i;
+                    size_t dots = 0;
+                    bool exponent = false;
+
+                    while (i < n && (std::isdigit(static_cast<unsigned char>(expression[i])) || expression[i] == '.')) {
+                        dots += (expression[i] == '.');
+                        i++;
+                    }
+
+                    if (i < n && (expression[i] == 'e' || expression[i] == 'E')) {
+                        exponent = true;
+                        i++;
+                        if (i < n && (expression[i] == '+' || expression[i] == '-'))
+                            i++;
+
+                        if (i == n || ! std::isdigit(static_cast<unsigned char>(expression[i])))
+                            return false;
+
+                        while (i < n && std::isdigit(static_cast<unsigned char>(expression[i])))
+                            i++;
+                    }
+
+                    if (dots > 1 || (i < n && isIdentifier(expression[i])))
+                        return false;
+
+                    code += expression.substr(start, i - start);
+                    if (! dots && ! exponent)
+                        code += ".";
+
+                    continue;
+                }
+
+                if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+                    size_t start = i;
+                    while (i < n && isIdentifier(expression[i]))
+                        i++;
+
+                    std::string name = expression.substr(start, i - start);
+
+                    if (name == "TMath" && expression.compare(i, 2, "::") == 0) {
+                        i += 2;
+                        start = i;
+                        while (i < n && isIdentifier(expression[i]))
+                            i++;
+
+                        name += "::" + expression.substr(start, i - start);
+                    }
+
+                    size_t next = i;
+                    while (next < n && std::isspace(static_cast<unsigned char>(expression[next])))
+                        next++;
+
+                    if (next < n && expression[next] == '(') {
+                        auto function = FUNCTIONS.find(name);
+                        if (function == FUNCTIONS.end())
+                            return false;
+
+                        code += function->second;
+                        continue;
+                    }
+
+                    if (name.find("::") != std::string::npos)
+                        return false;
+
+                    auto input = std::find(inputs.begin(), inputs.end(), name);
+                    size_t index = input - inputs.begin();
+                    if (input == inputs.end())
+                        inputs.push_back(name);
+
+                    code += "in[" + std::to_string(index) + "]";
+                    continue;
+                }
+
+                static const std::vector<std::string> OPERATORS = {"&&", "||", "==", "!=", "<=", ">="};
+                if (std::find(OPERATORS.begin(), OPERATORS.end(), expression.substr(i, 2)) != OPERATORS.end()) {
+                    code += expression.substr(i, 2);
+                    i += 2;
+                    continue;
+                }
+
+                if (expression.compare(i, 2, "->") == 0)
+                    return false;
+
+                if (std::string("+-*/<>!(),").find(c) == std::string::npos)
+                    return false;
+
+                // TTreeFormula returns 0 when dividing by 0. Only divisions by a non-zero number,
+                // where this cannot happen, are translated
+                if (c == '/') {
+                    size_t next = i + 1;
+                    while (next < n && std::isspace(static_cast<unsigned char>(expression[next])))
+                        next++;
+
+                    size_t end = next;
+                    while (end < n && (isIdentifier(expression[end]) || expression[end] == '.' ||
+                                ((expression[end] == '+' || expression[end] == '-') && (expression[end - 1] == 'e' || expression[end - 1] == 'E'))))
+                        end++;
+
+                    std::string divisor = expression.substr(next, end - next);
+
+                    char* parsed = nullptr;
+                    double value = divisor.empty() ? 0 : std::strtod(divisor.c_str(), &parsed);
+                    if (divisor.empty() || ! (std::isdigit(static_cast<unsigned char>(divisor[0])) || divisor[0] == '.') || *parsed != '\0' || value == 0)
+                        return false;
+                }
+
+                // Keep "a - -b" from becoming a decrement
+                code += c;
+                if (c == '+' || c == '-')
+                    code += ' ';
+
+                i++;
+            }
+
+            return ! code.empty();
+        }
+    }
+
+    bool ExpressionCompiler::isScalarLeaf(const TLeaf* leaf) {
+        if (! leaf || leaf->GetLeafCount() || leaf->GetLen() != 1)
+            return false;
+
+        return LEAF_TYPES.count(leaf->GetTypeName()) != 0;
+    }
+
+    void ExpressionCompiler::setCacheDirectory(const std::string& directory) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cache_directory = directory;
+    }
+
+    const CompiledExpression* ExpressionCompiler::compile(const std::string& expression, TTree& tree) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_cache_directory.empty())
+            return nullptr;
+
+        // Whitespaces are not significant
+        std::string key = expression;
+        key.erase(std::remove_if(key.begin(), key.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); }), key.end());
+
+        auto it = m_expressions.find(key);
+        if (it == m_expressions.end())
+            it = m_expressions.emplace(key, build(expression)).first;
+
+        const CompiledExpression* compiled = it->second.get();
+        if (! compiled)
+            return nullptr;
+
+        // The same expression can be used on trees with a different structure
+        for (const auto& input: compiled->inputs) {
+            if (! isScalarLeaf(tree.GetLeaf(input.c_str())))
+                return nullptr;
+        }
+
+        return compiled;
+    }
+
+    std::shared_ptr<CompiledExpression> ExpressionCompiler::build(const std::string& expression) {
+        std::shared_ptr<CompiledExpression> compiled(new CompiledExpression());
+
+        std::string code;
+        if (! translate(expression, code, compiled->inputs))
+            return nullptr;
+
+        // The helpers are part of the hash, so that kernels built with other helpers are not reused
+        std::string function_name = "plotIt_kernel_" + fingerprint(PRELUDE + code);
+
+        fs::path directory(m_cache_directory);
+        fs::path source = directory / (function_name + ".cxx");
+
+        // The code is entirely determined by the hash, an existing file can be reused as is.
+        // ACLiC then only rebuilds the library if it's older than the source
+        if (! fs::exists(source)) {
+            fs::create_directories(directory);
+
+            std::string comment = expression;
+            std::replace(comment.begin(), comment.end(), '\n', ' ');
+
+            std::ofstream out(source.string());
+            out << "// Generated by plotIt from the expression: " << comment << std::endl;
+            out << PRELUDE << std::endl;
+            out << "extern \"C\" double " << function_name << "(const double* in) {" << std::endl;
+            out << "    return " << code << ";" << std::endl;
+            out << "}" << std::endl;
+        }
+
+        if (! gSystem->CompileMacro(source.string().c_str(), "kOs")) {
+            std::cout << "Warning: failed to compile expression '" << expression << "', falling back to TTreeFormula" << std::endl;
+            return nullptr;
+        }
+
+        compiled->function = reinterpret_cast<CompiledExpression::Function>(gSystem->DynFindSymbol("*", function_name.c_str()));
+        if (! compiled->function) {
+            std::cout << "Warning: compiled expression '" << expression << "' cannot be loaded, falling back to TTreeFormula" << std::endl;
+            return nullptr;
+        }
+
+        return compiled;
+    }
+}
@@ -0,0 +1,63 @@
+#include <globmatcher.h>
+
+#include <fnmatch.h>
+
+#include <algorithm>
+#include <cctype>
+
+namespace plotIt {
+
+    namespace {
+        std::string lowercase(const std::string& str) {
+            std::string result = str;
+            std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return std::tolower(c); });
+
+            return result;
+        }
+    }
+
+    size_t GlobMatcher::add(const std::string& pattern, const std::string& exclude/* = ""*/) {
+        size_t index = m_patterns.size();
+        m_patterns.push_back({pattern, exclude});
+
+        // Literal part of the pattern, up to the first special character
+        std::string prefix = lowercase(pattern.substr(0, pattern.find_first_of("*?[\\")));
+
+        m_buckets[prefix].push_back(index);
+
+        auto length = std::lower_bound(m_prefix_lengths.begin(), m_prefix_lengths.end(), prefix.size());
+        if (length == m_prefix_lengths.end() || *length != prefix.size())
+            m_prefix_lengths.insert(length, prefix.size());
+
+        return index;
+    }
+
+    void GlobMatcher::match(const std::string& name, std::vector<size_t>& matches) const {
+        matches.clear();
+
+        std::string lowercase_name = lowercase(name);
+
+        for (size_t length: m_prefix_lengths) {
+            if (length > lowercase_name.size())
+                break;
+
+            auto bucket = m_buckets.find(lowercase_name.substr(0, length));
+            if (bucket == m_buckets.end())
+                continue;
+
+            for (size_t index: bucket->second) {
+                const Pattern& pattern = m_patterns[index];
+
+                if (fnmatch(pattern.pattern.c_str(), name.c_str(), FNM_CASEFOLD) != 0)
+                    continue;
+
+                if (! pattern.exclude.empty() && fnmatch(pattern.exclude.c_str(), name.c_str(), FNM_CASEFOLD) == 0)
+                    continue;
+
+                matches.push_back(index);
+            }
+        }
+
+        std::sort(matches.begin(), matches.end());
+    }
+}
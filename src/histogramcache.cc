@@ -0,0 +1,114 @@
+#include <histogramcache.h>
+#include <types.h>
+#include <utilities.h>
+#include <uuid.h>
+
+#include <TFile.h>
+#include <TH1.h>
+
+#include <iostream>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace plotIt {
+
+    HistogramCache::HistogramCache(const std::string& directory):
+        m_directory(directory) {
+
+    }
+
+    std::string HistogramCache::key(const Plot& plot, const std::string& tree_name) {
+        auto x_axis_range = plot.log_x ? plot.log_x_axis_range : plot.x_axis_range;
+        auto y_axis_range = plot.log_y ? plot.log_y_axis_range : plot.y_axis_range;
+
+        std::ostringstream identity;
+        identity.precision(17);
+        identity << tree_name << '\n' << normalizeExpression(plot.draw_string) << '\n' << normalizeExpression(plot.selection_string) << '\n'
+            << plot.binning_x << ' ' << x_axis_range.start << ' ' << x_axis_range.end;
+
+        if (plot.binning_y)
+            identity << '\n' << plot.binning_y << ' ' << y_axis_range.start << ' ' << y_axis_range.end;
+
+        return "h_" + fingerprint(identity.str());
+    }
+
+    std::string HistogramCache::cacheFile(const std::string& path) const {
+        std::string identity = fileIdentity(path);
+        if (identity.empty())
+            return "";
+
+        return (fs::path(m_directory) / (fingerprint(identity) + ".root")).string();
+    }
+
+    std::vector<std::shared_ptr<TH1>> HistogramCache::load(const std::string& path, const std::vector<std::string>& keys) const {
+        std::vector<std::shared_ptr<TH1>> histograms(keys.size());
+
+        std::string cache_file = cacheFile(path);
+        if (cache_file.empty() || ! fs::exists(cache_file))
+            return histograms;
+
+        std::unique_ptr<TFile> file(TFile::Open(cache_file.c_str()));
+        if (! file || file->IsZombie())
+            return histograms;
+
+        for (size_t i = 0; i < keys.size(); i++) {
+            TH1* hist = nullptr;
+            file->GetObject(keys[i].c_str(), hist);
+
+            if (hist) {
+                hist->SetDirectory(nullptr);
+                histograms[i].reset(hist);
+            }
+        }
+
+        return histograms;
+    }
+
+    void HistogramCache::save(const std::string& path, const std::vector<std::string>& keys, const std::vector<TH1*>& histograms) const {
+        std::string cache_file = cacheFile(path);
+        if (cache_file.empty() || keys.empty())
+            return;
+
+        boost::system::error_code error;
+        fs::create_directories(m_directory, error);
+
+        // Update a copy of the cache file, and replace the original at once. A crash or a
+        // concurrent run then never leaves a partially written cache file behind
+        std::string temporary = cache_file + "." + get_uuid() + ".root";
+
+        bool update = fs::exists(cache_file);
+        if (update)
+            fs::copy_file(cache_file, temporary, error);
+
+        std::unique_ptr<TFile> file;
+        if (update && ! error)
+            file.reset(TFile::Open(temporary.c_str(), "update"));
+
+        // Corrupted cache files are started over
+        if (! file || file->IsZombie())
+            file.reset(TFile::Open(temporary.c_str(), "recreate"));
+
+        if (! file || file->IsZombie()) {
+            std::cout << "Warning: failed to write histogram cache '" << cache_file << "'" << std::endl;
+            fs::remove(temporary, error);
+            return;
+        }
+
+        bool success = true;
+        for (size_t i = 0; i < keys.size(); i++)
+            success &= (file->WriteTObject(histograms[i], keys[i].c_str(), "Overwrite") > 0);
+
+        file->Close();
+
+        if (success)
+            fs::rename(temporary, cache_file, error);
+
+        if (! success || error) {
+            std::cout << "Warning: failed to write histogram cache '" << cache_file << "'" << std::endl;
+            fs::remove(temporary, error);
+        }
+    }
+}
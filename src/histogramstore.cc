@@ -0,0 +1,397 @@
+#include <histogramstore.h>
+#include <inputfile.h>
+#include <utilities.h>
+#include <uuid.h>
+
+#include <TClass.h>
+#include <TH1.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace plotIt {
+
+    namespace {
+
+        // Bump the last character when the layout or the content changes
+        const char MAGIC[8] = {'P', 'L', 'T', 'P', 'A', 'C', 'K', '4'};
+
+        struct Header {
+            char magic[8];
+            uint64_t count;
+            uint64_t index_offset;
+        };
+
+        enum RecordFlags: uint64_t {
+            VARIABLE_BINS = 1,
+            SUMW2 = 2,
+            // The histogram is a TH1F, otherwise a TH1D
+            SINGLE_PRECISION = 4
+        };
+
+        /**
+         * A histogram with `bins` bins is stored as this record, followed by its title padded to
+         * 8 bytes, by its bin edges if VARIABLE_BINS is set, by its (bins + 2) bin contents,
+         * including underflow and overflow, and by its (bins + 2) sums of weights squared if SUMW2 is set.
+         * The bin contents are stored as doubles, also for a TH1F.
+         *
+         * The index, at the end of the file, lists all the keys of the input file, packed or not, in
+         * the order of InputFile::entries. Each entry holds the offset of the record of the histogram,
+         * or NOT_PACKED, the cycle of the key, the length of its path and of its class name, followed by
+         * its path and its class name, each padded to 8 bytes.
+         **/
+        struct Record {
+            uint64_t bins;
+            uint64_t flags;
+            uint64_t title_size;
+            double minimum;
+            double maximum;
+            double entries;
+            double stats[4];
+        };
+
+        const uint64_t NOT_PACKED = ~uint64_t(0);
+
+        struct IndexEntry {
+            uint64_t offset;
+            uint64_t cycle;
+            uint64_t path_size;
+            uint64_t class_size;
+        };
+
+        uint64_t padded(uint64_t size) {
+            return (size + 7) & ~uint64_t(7);
+        }
+
+        class Writer {
+            public:
+                Writer(const std::string& path):
+                    m_out(path, std::ios::binary) {
+
+                }
+
+                bool good() const { return m_out.good(); }
+                uint64_t offset() const { return m_offset; }
+
+                void write(const void* data, uint64_t size) {
+                    m_out.write(static_cast<const char*>(data), size);
+                    m_offset += size;
+                }
+
+                void writeString(const std::string& s) {
+                    static const char zeros[8] = {0};
+
+                    write(s.data(), s.size());
+                    write(zeros, padded(s.size()) - s.size());
+                }
+
+                void rewind() {
+                    m_out.seekp(0);
+                }
+
+            private:
+                std::ofstream m_out;
+                uint64_t m_offset = 0;
+        };
+
+        bool write(Writer& out, const TH1& hist) {
+            const TAxis* axis = hist.GetXaxis();
+            uint64_t bins = hist.GetNbinsX();
+
+            Record record;
+            std::memset(&record, 0, sizeof(record));
+
+            std::string title = hist.GetTitle();
+
+            record.bins = bins;
+            record.title_size = title.size();
+            record.minimum = axis->GetXmin();
+            record.maximum = axis->GetXmax();
+            record.entries = hist.GetEntries();
+
+            // GetStats fills up to 13 values for a TH3, only the first 4 are used in 1D
+            double stats[13] = {0};
+            hist.GetStats(stats);
+            std::memcpy(record.stats, stats, sizeof(record.stats));
+
+            if (axis->GetXbins()->GetSize())
+                record.flags |= VARIABLE_BINS;
+            if (hist.GetSumw2N())
+                record.flags |= SUMW2;
+            if (hist.IsA() == TH1F::Class())
+                record.flags |= SINGLE_PRECISION;
+
+            out.write(&record, sizeof(record));
+            out.writeString(title);
+
+            if (record.flags & VARIABLE_BINS)
+                out.write(axis->GetXbins()->GetArray(), (bins + 1) * sizeof(double));
+
+            std::vector<double> contents(bins + 2);
+            for (uint64_t i = 0; i < bins + 2; i++)
+                contents[i] = hist.GetBinContent(i);
+
+            out.write(contents.data(), contents.size() * sizeof(double));
+
+            if (record.flags & SUMW2)
+                out.write(hist.GetSumw2()->GetArray(), (bins + 2) * sizeof(double));
+
+            return out.good();
+        }
+
+        /**
+         * Create a histogram of class H from a record
+         **/
+        template <typename H>
+        std::shared_ptr<TH1> create(const std::string& name, const std::string& title, const Record& record, const double* edges, const double* contents, const double* sumw2) {
+            uint64_t bins = record.bins;
+
+            std::shared_ptr<H> hist;
+            if (edges)
+                hist.reset(new H(name.c_str(), title.c_str(), bins, edges));
+            else
+                hist.reset(new H(name.c_str(), title.c_str(), bins, record.minimum, record.maximum));
+
+            hist->SetDirectory(nullptr);
+
+            // TH1 always owns its arrays, so the mapped arrays are copied in one go
+            std::copy(contents, contents + bins + 2, hist->GetArray());
+
+            if (sumw2) {
+                hist->Sumw2();
+                std::memcpy(hist->GetSumw2()->GetArray(), sumw2, (bins + 2) * sizeof(double));
+            } else if (hist->GetSumw2N()) {
+                // Created by TH1::SetDefaultSumw2, but the original histogram had none
+                hist->GetSumw2()->Set(0);
+            }
+
+            hist->SetEntries(record.entries);
+
+            double stats[4];
+            std::memcpy(stats, record.stats, sizeof(stats));
+            hist->PutStats(stats);
+
+            return hist;
+        }
+    }
+
+    template <typename T>
+    const T* HistogramStore::at(uint64_t offset, uint64_t count) const {
+        if (offset % alignof(T) != 0 || offset > m_size || count > (m_size - offset) / sizeof(T))
+            return nullptr;
+
+        return reinterpret_cast<const T*>(m_data + offset);
+    }
+
+    std::shared_ptr<HistogramStore> HistogramStore::open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return nullptr;
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+            close(fd);
+            return nullptr;
+        }
+
+        void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+        // The mapping stays valid once the file is closed
+        close(fd);
+
+        if (data == MAP_FAILED)
+            return nullptr;
+
+        std::shared_ptr<HistogramStore> store(new HistogramStore());
+        store->m_data = static_cast<const char*>(data);
+        store->m_size = info.st_size;
+
+        const Header* header = store->at<Header>(0, 1);
+        if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+            return nullptr;
+
+        uint64_t offset = header->index_offset;
+        store->m_entries.reserve(std::min<uint64_t>(header->count, store->m_size / sizeof(IndexEntry)));
+
+        for (uint64_t i = 0; i < header->count; i++) {
+            const IndexEntry* entry = store->at<IndexEntry>(offset, 1);
+            if (! entry)
+                return nullptr;
+
+            offset += sizeof(IndexEntry);
+
+            const char* path = store->at<char>(offset, entry->path_size);
+            offset += padded(entry->path_size);
+
+            const char* class_name = store->at<char>(offset, entry->class_size);
+            offset += padded(entry->class_size);
+
+            if (! path || ! class_name)
+                return nullptr;
+
+            InputFile::Entry e;
+            e.path.assign(path, entry->path_size);
+            e.class_name.assign(class_name, entry->class_size);
+            e.cycle = static_cast<short>(entry->cycle);
+
+            std::string with_cycle = e.path + ";" + std::to_string(e.cycle);
+
+            if (entry->offset != NOT_PACKED) {
+                store->m_index.emplace(e.path, entry->offset);
+                store->m_index.emplace(with_cycle, entry->offset);
+            }
+
+            // The highest cycle of each name comes first
+            store->m_keys.emplace(e.path);
+            store->m_keys.emplace(with_cycle);
+
+            store->m_entries.push_back(std::move(e));
+        }
+
+        return store;
+    }
+
+    HistogramStore::~HistogramStore() {
+        if (m_data)
+            munmap(const_cast<char*>(m_data), m_size);
+    }
+
+    std::string HistogramStore::path(const std::string& directory, const std::string& input) {
+        std::string identity = fileIdentity(input);
+        if (identity.empty())
+            return "";
+
+        return (fs::path(directory) / (fingerprint(identity) + ".pack")).string();
+    }
+
+    std::shared_ptr<TH1> HistogramStore::read(const std::string& name) const {
+        auto it = m_index.find(name);
+        if (it == m_index.end())
+            return nullptr;
+
+        uint64_t offset = it->second;
+
+        const Record* record = at<Record>(offset, 1);
+        if (! record)
+            return nullptr;
+
+        uint64_t bins = record->bins;
+        offset += sizeof(Record);
+
+        const char* title = at<char>(offset, record->title_size);
+        offset += padded(record->title_size);
+
+        const double* edges = nullptr;
+        if (record->flags & VARIABLE_BINS) {
+            edges = at<double>(offset, bins + 1);
+            offset += (bins + 1) * sizeof(double);
+        }
+
+        const double* contents = at<double>(offset, bins + 2);
+        offset += (bins + 2) * sizeof(double);
+
+        const double* sumw2 = nullptr;
+        if (record->flags & SUMW2)
+            sumw2 = at<double>(offset, bins + 2);
+
+        if (! title || ! contents || ((record->flags & VARIABLE_BINS) && ! edges) || ((record->flags & SUMW2) && ! sumw2))
+            return nullptr;
+
+        std::string hist_title(title, record->title_size);
+
+        if (record->flags & SINGLE_PRECISION)
+            return create<TH1F>(name, hist_title, *record, edges, contents, sumw2);
+
+        return create<TH1D>(name, hist_title, *record, edges, contents, sumw2);
+    }
+
+    int64_t HistogramStore::pack(const std::string& input, const std::string& path) {
+        std::shared_ptr<InputFile> file = InputFile::open(input);
+        if (! file)
+            return -1;
+
+        boost::system::error_code error;
+        fs::create_directories(fs::path(path).parent_path(), error);
+
+        // Write to a temporary file first, so that a partial store is never mapped
+        std::string temporary = path + "." + get_uuid();
+
+        // Offset of the record of each key of the file, or NOT_PACKED
+        const std::vector<InputFile::Entry>& entries = file->entries();
+        std::vector<uint64_t> offsets(entries.size(), NOT_PACKED);
+
+        std::unordered_set<std::string> seen;
+        int64_t packed = 0;
+
+        {
+            Writer out(temporary);
+
+            Header header;
+            std::memset(&header, 0, sizeof(header));
+            out.write(&header, sizeof(header));
+
+            for (size_t i = 0; i < entries.size(); i++) {
+                const InputFile::Entry& entry = entries[i];
+
+                // Only the highest cycle of each name, which comes first
+                if (! seen.insert(entry.path).second)
+                    continue;
+
+                // Only plain histograms: the contents and errors of classes like TProfile
+                // are not their raw arrays
+                TClass* cl = TClass::GetClass(entry.class_name.c_str());
+                if (cl != TH1F::Class() && cl != TH1D::Class())
+                    continue;
+
+                std::shared_ptr<TH1> hist = std::dynamic_pointer_cast<TH1>(file->read(entry.path));
+                if (! hist || hist->IsA() != cl || hist->GetXaxis()->GetLabels())
+                    continue;
+
+                offsets[i] = out.offset();
+                packed++;
+
+                if (! write(out, *hist))
+                    break;
+            }
+
+            header.count = entries.size();
+            header.index_offset = out.offset();
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+
+            for (size_t i = 0; i < entries.size(); i++) {
+                IndexEntry entry = {offsets[i], static_cast<uint64_t>(entries[i].cycle), entries[i].path.size(), entries[i].class_name.size()};
+                out.write(&entry, sizeof(entry));
+                out.writeString(entries[i].path);
+                out.writeString(entries[i].class_name);
+            }
+
+            out.rewind();
+            out.write(&header, sizeof(header));
+
+            if (! out.good()) {
+                fs::remove(temporary, error);
+                return -1;
+            }
+        }
+
+        fs::rename(temporary, path, error);
+        if (error) {
+            fs::remove(temporary, error);
+            return -1;
+        }
+
+        return packed;
+    }
+}
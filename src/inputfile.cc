@@ -0,0 +1,213 @@
+#include <commandlinecfg.h>
+#include <histogramstore.h>
+#include <inputfile.h>
+
+#include <TCollection.h>
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TH1.h>
+#include <TKey.h>
+
+#include <algorithm>
+
+namespace plotIt {
+
+    std::shared_ptr<InputFile> InputFile::open(const std::string& path) {
+        std::shared_ptr<InputFile> input(new InputFile());
+        input->m_path = path;
+
+        const std::string& pack_dir = CommandLineCfg::get().pack_dir;
+        if (! pack_dir.empty()) {
+            std::string store = HistogramStore::path(pack_dir, path);
+            if (! store.empty())
+                input->m_store = HistogramStore::open(store);
+
+            // The ROOT file is opened only if an object is missing from the store
+            if (input->m_store)
+                return input;
+        }
+
+        if (! input->file())
+            return nullptr;
+
+        return input;
+    }
+
+    TFile* InputFile::file() {
+        if (m_opened)
+            return m_file.get();
+
+        m_opened = true;
+
+        m_file.reset(TFile::Open(m_path.c_str()));
+        if (! m_file || m_file->IsZombie()) {
+            m_file.reset();
+            return nullptr;
+        }
+
+        index(m_file.get(), "");
+
+        return m_file.get();
+    }
+
+    // Defined here, where TFile is a complete type
+    InputFile::~InputFile() = default;
+
+    void InputFile::index(TDirectory* directory, const std::string& prefix) {
+        TIter it(directory->GetListOfKeys());
+        TKey* key = nullptr;
+
+        while ((key = static_cast<TKey*>(it()))) {
+            std::string path = prefix + key->GetName();
+            std::string cl = key->GetClassName();
+
+            if (cl.find("TDirectory") != std::string::npos) {
+                TDirectory* subdirectory = directory->GetDirectory(key->GetName());
+                if (subdirectory)
+                    index(subdirectory, path + "/");
+
+                continue;
+            }
+
+            m_entries.push_back({path, cl, key->GetCycle()});
+
+            // Keys are listed with the highest cycle first
+            m_keys.emplace(path, key);
+            m_keys.emplace(path + ";" + std::to_string(key->GetCycle()), key);
+        }
+    }
+
+    const std::vector<InputFile::Entry>& InputFile::entries() {
+        if (m_store)
+            return m_store->entries();
+
+        file();
+        return m_entries;
+    }
+
+    bool InputFile::contains(const std::string& path) {
+        if (m_store)
+            return m_store->listed(path);
+
+        return key(path) != nullptr;
+    }
+
+    TKey* InputFile::key(const std::string& path) {
+        file();
+
+        auto it = m_keys.find(path);
+        if (it == m_keys.end())
+            return nullptr;
+
+        return it->second;
+    }
+
+    std::shared_ptr<TObject> InputFile::read(const std::string& path) {
+        if (m_store && m_store->contains(path))
+            return m_store->read(path);
+
+        if (m_store && ! m_store->listed(path))
+            return nullptr;
+
+        TKey* key = this->key(path);
+        if (! key)
+            return nullptr;
+
+        return own(key->ReadObj());
+    }
+
+    std::vector<std::shared_ptr<TObject>> InputFile::read(const std::vector<std::string>& paths) {
+        std::vector<std::shared_ptr<TObject>> objects(paths.size());
+
+        std::vector<Batch> batches = fetch(paths, objects);
+        for (Batch& batch: batches) {
+            for (size_t r = 0; r < batch.records.size(); r++)
+                objects[batch.records[r].index] = deserialize(batch, r);
+        }
+
+        return objects;
+    }
+
+    std::vector<InputFile::Batch> InputFile::fetch(const std::vector<std::string>& paths, std::vector<std::shared_ptr<TObject>>& objects) {
+        std::vector<Batch> batches;
+
+        // Index in `paths` of the objects to read from the ROOT file, and their key
+        std::vector<std::pair<size_t, TKey*>> keys;
+
+        for (size_t i = 0; i < paths.size(); i++) {
+            if (m_store && m_store->contains(paths[i])) {
+                objects[i] = m_store->read(paths[i]);
+                continue;
+            }
+
+            if (m_store && ! m_store->listed(paths[i]))
+                continue;
+
+            TKey* key = this->key(paths[i]);
+            if (key)
+                keys.emplace_back(i, key);
+        }
+
+        std::sort(keys.begin(), keys.end(), [](const std::pair<size_t, TKey*>& a, const std::pair<size_t, TKey*>& b) {
+            return a.second->GetSeekKey() < b.second->GetSeekKey();
+        });
+
+        // Read the keys in batches of at most BATCH_SIZE bytes, each with a single vectored read.
+        // A key larger than BATCH_SIZE is read alone
+        const int64_t BATCH_SIZE = 32 * 1024 * 1024;
+
+        std::vector<Long64_t> positions;
+        std::vector<Int_t> lengths;
+
+        size_t begin = 0;
+        while (begin < keys.size()) {
+            positions.clear();
+            lengths.clear();
+
+            Batch batch;
+
+            int64_t size = 0;
+            size_t end = begin;
+            while (end < keys.size() && (end == begin || size + keys[end].second->GetNbytes() <= BATCH_SIZE)) {
+                TKey* key = keys[end].second;
+
+                batch.records.push_back({keys[end].first, key, static_cast<size_t>(size)});
+                positions.push_back(key->GetSeekKey());
+                lengths.push_back(key->GetNbytes());
+
+                size += key->GetNbytes();
+                end++;
+            }
+
+            batch.buffer.resize(size);
+
+            // ReadBuffers returns true on failure. Fall back to reading the keys one by one
+            if (m_file->ReadBuffers(batch.buffer.data(), positions.data(), lengths.data(), positions.size())) {
+                for (const auto& record: batch.records)
+                    objects[record.index] = own(record.key->ReadObj());
+            } else {
+                batches.push_back(std::move(batch));
+            }
+
+            begin = end;
+        }
+
+        return batches;
+    }
+
+    std::shared_ptr<TObject> InputFile::deserialize(Batch& batch, size_t record) {
+        const Batch::Record& r = batch.records[record];
+        return own(r.key->ReadObjWithBuffer(batch.buffer.data() + r.offset));
+    }
+
+    std::shared_ptr<TObject> InputFile::own(TObject* object) {
+        std::shared_ptr<TObject> result(object);
+
+        // Histograms register themselves to the directory they are read from
+        TH1* hist = dynamic_cast<TH1*>(object);
+        if (hist)
+            hist->SetDirectory(nullptr);
+
+        return result;
+    }
+}
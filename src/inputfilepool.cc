@@ -0,0 +1,94 @@
+#include <commandlinecfg.h>
+#include <inputfilepool.h>
+
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace plotIt {
+
+    std::shared_ptr<InputFile> InputFilePool::open(const std::string& path) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto it = m_index.find(path);
+            if (it != m_index.end()) {
+                m_files.splice(m_files.begin(), m_files, it->second);
+                return it->second->second;
+            }
+        }
+
+        // Opening and indexing a file is slow, do not block the other threads meanwhile
+        std::shared_ptr<InputFile> file = InputFile::open(path);
+        if (! file)
+            return nullptr;
+
+        std::vector<std::shared_ptr<InputFile>> evicted;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            // Opened by another thread meanwhile
+            auto it = m_index.find(path);
+            if (it != m_index.end()) {
+                m_files.splice(m_files.begin(), m_files, it->second);
+                return it->second->second;
+            }
+
+            m_files.emplace_front(path, file);
+            m_index[path] = m_files.begin();
+
+            evicted = evict(std::max<size_t>(CommandLineCfg::get().max_open_files, 1));
+        }
+
+        return file;
+    }
+
+    std::shared_ptr<const std::vector<std::string>> InputFilePool::listing(const std::string& directory) {
+        // Held while listing, so that a directory is listed only once even when its files are loaded in parallel
+        std::lock_guard<std::mutex> lock(m_listings_mutex);
+
+        auto it = m_listings.find(directory);
+        if (it != m_listings.end())
+            return it->second;
+
+        std::shared_ptr<std::vector<std::string>> names = std::make_shared<std::vector<std::string>>();
+
+        boost::system::error_code error;
+        fs::directory_iterator entry(directory.empty() ? fs::path(".") : fs::path(directory), error);
+
+        for (fs::directory_iterator end; ! error && entry != end; entry.increment(error)) {
+            fs::path filename = entry->path().filename();
+            if (filename.extension() == ".root")
+                names->push_back(filename.string());
+        }
+
+        std::sort(names->begin(), names->end());
+        m_listings.emplace(directory, names);
+
+        return names;
+    }
+
+    void InputFilePool::clear() {
+        std::vector<std::shared_ptr<InputFile>> evicted;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            evicted = evict(0);
+        }
+    }
+
+    std::vector<std::shared_ptr<InputFile>> InputFilePool::evict(size_t maximum) {
+        std::vector<std::shared_ptr<InputFile>> evicted;
+
+        while (m_files.size() > maximum) {
+            evicted.push_back(m_files.back().second);
+            m_index.erase(m_files.back().first);
+            m_files.pop_back();
+        }
+
+        return evicted;
+    }
+}
@@ -0,0 +1,52 @@
+#include <kernels.h>
+
+#include <algorithm>
+#include <cmath>
+
+// Built with -fopenmp-simd, for the reductions, and -fno-math-errno, so that std::sqrt can be vectorized.
+// No OpenMP runtime is needed
+
+namespace plotIt {
+    namespace kernels {
+
+        double envelope(const double* __restrict__ nominal, const double* __restrict__ up, const double* __restrict__ down, size_t n) {
+            double total = 0;
+
+            // The sums are reordered, which is only allowed explicitly for floating point numbers
+            #pragma omp simd reduction(+:total)
+            for (size_t i = 0; i < n; i++)
+                total += std::max(std::abs(up[i] - nominal[i]), std::abs(nominal[i] - down[i]));
+
+            return total;
+        }
+
+        double addEnvelope(const double* __restrict__ nominal, const double* __restrict__ up, const double* __restrict__ down, double* __restrict__ sum, size_t n) {
+            double total = 0;
+
+            #pragma omp simd reduction(+:total)
+            for (size_t i = 0; i < n; i++) {
+                double error = std::max(std::abs(up[i] - nominal[i]), std::abs(nominal[i] - down[i]));
+
+                sum[i] += error;
+                total += error;
+            }
+
+            return total;
+        }
+
+        void addSquares(const double* __restrict__ values, double* __restrict__ sum, size_t n) {
+            for (size_t i = 0; i < n; i++)
+                sum[i] += values[i] * values[i];
+        }
+
+        void squareRoot(double* values, size_t n) {
+            for (size_t i = 0; i < n; i++)
+                values[i] = std::sqrt(values[i]);
+        }
+
+        void quadrature(const double* __restrict__ a, const double* __restrict__ b, double* __restrict__ result, size_t n) {
+            for (size_t i = 0; i < n; i++)
+                result[i] = std::sqrt(a[i] * a[i] + b[i] * b[i]);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include "plotIt.h"
+
+#include <TROOT.h>
+#include <TTreeCache.h>
+
+#include "tclap/CmdLine.h"
+
+#include <commandlinecfg.h>
+#include <expressioncompiler.h>
+
+int main(int argc, char** argv) {
+
+  try {
+
+    TCLAP::CmdLine cmd("Plot histograms", ' ', "0.1");
+
+    TCLAP::ValueArg<std::string> histogramsFolderArg("i", "histograms-folder", "histograms base folder (default: current directory)", false, "./", "string", cmd);
+
+    TCLAP::ValueArg<std::string> outputFolderArg("o", "output-folder", "output folder", true, "", "string", cmd);
+
+    TCLAP::ValueArg<std::string> eraArg("e", "era", "era to restrict to", false, "", "string", cmd);
+
+    TCLAP::SwitchArg ignoreScaleArg("", "ignore-scales", "Ignore any scales present in the configuration file", cmd, false);
+
+    TCLAP::SwitchArg verboseArg("v", "verbose", "Verbose output (print summary)", cmd, false);
+
+    TCLAP::SwitchArg yieldsArg("y", "yields", "Produce LaTeX table of yields", cmd, false);
+
+    TCLAP::SwitchArg plotsArg("p", "plots", "Do not produce the plots - can be useful if only the yields table is needed", cmd, false);
+
+    TCLAP::SwitchArg unblindArg("u", "unblind", "Unblind the plots, ie ignore any blinded-range in the configuration", cmd, false);
+
+    TCLAP::ValueArg<size_t> threadsArg("j", "threads", "Number of threads used to load the histograms, or to fill them in tree mode (default: 1)", false, 1, "int", cmd);
+
+    TCLAP::SwitchArg cacheArg("", "cache", "Cache in the output folder the list of objects of each input file, and in tree mode the histograms and the entries passing their selections. The next runs only scan the files and fill the histograms whose inputs changed, and only read the selected entries", cmd, false);
+
+    TCLAP::ValueArg<double> previewArg("", "preview", "Tree mode only: fill the histograms from the first clusters of each file, covering at least this fraction of the entries, and scale them to the full number of entries. Plots are marked as previews", false, 1, "fraction", cmd);
+
+    TCLAP::SwitchArg compileExpressionsArg("", "compile-expressions", "Compile the draw and selection strings of tree mode into C++ functions when possible. The compiled functions are cached in the output folder", cmd, false);
+
+    TCLAP::ValueArg<std::string> packDirArg("", "pack-dir", "Read the histograms from the stores written by plotIt-pack in this folder. Stores of input files modified since they were packed are ignored", false, "", "string", cmd);
+
+    TCLAP::ValueArg<size_t> maxOpenFilesArg("", "max-open-files", "Maximum number of input files kept open at the same time, including the files of shape systematics. Files are reopened when needed (default: 100)", false, 100, "int", cmd);
+
+    TCLAP::SwitchArg systematicsBreakdownArg("b", "systs-breadown", "Print systematics details for each MC process separately in addition to the total contribution", cmd, false);
+
+    TCLAP::UnlabeledValueArg<std::string> configFileArg("configFile", "configuration file", true, "", "string", cmd);
+
+    cmd.parse(argc, argv);
+
+    //bool isData = dataArg.isSet();
+
+    fs::path histogramsPath(fs::canonical(histogramsFolderArg.getValue()));
+
+    if (! fs::exists(histogramsPath)) {
+      std::cout << "Error: histograms path " << histogramsPath << " does not exist" << std::endl;
+    }
+
+    fs::path outputPath(outputFolderArg.getValue());
+
+    if (! fs::exists(outputPath)) {
+      std::cout << "Error: output path " << outputPath << " does not exist" << std::endl;
+      return 1;
+    }
+
+    if (previewArg.getValue() <= 0 || previewArg.getValue() > 1) {
+      std::cout << "Error: preview fraction must be in ]0, 1]" << std::endl;
+      return 1;
+    }
+
+    if( plotsArg.getValue() && !yieldsArg.getValue() ) {
+      std::cerr << "Error: we have nothing to do" << std::endl;
+      return 1;
+    }
+
+    CommandLineCfg::get().era = eraArg.getValue();
+    CommandLineCfg::get().ignore_scales = ignoreScaleArg.getValue();
+    CommandLineCfg::get().verbose = verboseArg.getValue();
+    CommandLineCfg::get().do_plots = !plotsArg.getValue();
+    CommandLineCfg::get().do_yields = yieldsArg.getValue();
+    CommandLineCfg::get().unblind = unblindArg.getValue();
+    CommandLineCfg::get().systematicsBreakdown = systematicsBreakdownArg.getValue();
+    CommandLineCfg::get().threads = std::max<size_t>(threadsArg.getValue(), 1);
+
+    CommandLineCfg::get().compile_expressions = compileExpressionsArg.getValue();
+    CommandLineCfg::get().cache = cacheArg.getValue();
+    CommandLineCfg::get().preview_fraction = previewArg.getValue();
+    CommandLineCfg::get().pack_dir = packDirArg.getValue();
+    CommandLineCfg::get().max_open_files = std::max<size_t>(maxOpenFilesArg.getValue(), 1);
+
+    if (CommandLineCfg::get().threads > 1)
+      ROOT::EnableThreadSafety();
+
+    if (CommandLineCfg::get().compile_expressions)
+      plotIt::ExpressionCompiler::get().setCacheDirectory((outputPath / "plotIt_kernels").string());
+
+    plotIt::plotIt p(outputPath);
+    if (!p.parseConfigurationFile(configFileArg.getValue(), histogramsPath))
+        return 1;
+
+    // Process-wide setting of TTreeCache: set it once, before any tree is read from the worker threads
+    if (p.getConfiguration().tree_cache_learn_entries > 0)
+      TTreeCache::SetLearnEntries(p.getConfiguration().tree_cache_learn_entries);
+
+    p.plotAll();
+
+  } catch (TCLAP::ArgException &e) {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
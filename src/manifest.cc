@@ -0,0 +1,112 @@
+#include <manifest.h>
+#include <utilities.h>
+#include <uuid.h>
+
+#include <yaml-cpp/yaml.h>
+
+#include <fstream>
+#include <iostream>
+
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace plotIt {
+
+    Manifest::Manifest(const std::string& path):
+        m_path(path) {
+
+    }
+
+    void Manifest::load() {
+        m_entries.clear();
+        m_modified = false;
+
+        if (! fs::exists(m_path))
+            return;
+
+        try {
+            YAML::Node root = YAML::LoadFile(m_path);
+
+            for (YAML::const_iterator it = root.begin(); it != root.end(); ++it) {
+                Entry entry;
+                entry.path = it->second["path"].as<std::string>();
+                entry.content = it->second["content"].as<std::vector<std::string>>();
+
+                m_entries.emplace(it->first.as<std::string>(), entry);
+            }
+        } catch (YAML::Exception& e) {
+            std::cout << "Warning: ignoring invalid manifest '" << m_path << "': " << e.what() << std::endl;
+            m_entries.clear();
+        }
+    }
+
+    void Manifest::save() {
+        // Entries of deleted or modified files can never be used again
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            std::string identity = fileIdentity(it->second.path);
+            if (identity.empty() || fingerprint(identity) != it->first) {
+                it = m_entries.erase(it);
+                m_modified = true;
+            } else {
+                ++it;
+            }
+        }
+
+        if (! m_modified)
+            return;
+
+        YAML::Emitter out;
+        out << YAML::BeginMap;
+        for (const auto& entry: m_entries) {
+            out << YAML::Key << entry.first << YAML::Value << YAML::BeginMap;
+            out << YAML::Key << "path" << YAML::Value << entry.second.path;
+            out << YAML::Key << "content" << YAML::Value << entry.second.content;
+            out << YAML::EndMap;
+        }
+        out << YAML::EndMap;
+
+        // Write to a temporary file first, so that concurrent runs never read a partial manifest
+        std::string temporary = m_path + "." + get_uuid();
+        {
+            std::ofstream file(temporary);
+            file << out.c_str() << std::endl;
+
+            if (! file) {
+                std::cout << "Warning: failed to write manifest '" << m_path << "'" << std::endl;
+                return;
+            }
+        }
+
+        boost::system::error_code error;
+        fs::rename(temporary, m_path, error);
+        if (error) {
+            std::cout << "Warning: failed to write manifest '" << m_path << "'" << std::endl;
+            fs::remove(temporary, error);
+        }
+    }
+
+    const std::vector<std::string>* Manifest::content(const std::string& path) const {
+        std::string identity = fileIdentity(path);
+        if (identity.empty())
+            return nullptr;
+
+        auto it = m_entries.find(fingerprint(identity));
+        if (it == m_entries.end())
+            return nullptr;
+
+        return &it->second.content;
+    }
+
+    void Manifest::setContent(const std::string& path, const std::vector<std::string>& content) {
+        std::string identity = fileIdentity(path);
+        if (identity.empty())
+            return;
+
+        Entry& entry = m_entries[fingerprint(identity)];
+        entry.path = path;
+        entry.content = content;
+
+        m_modified = true;
+    }
+}
@@ -0,0 +1,113 @@
+#include "plotIt.h"
+
+#include <TROOT.h>
+
+#include "tclap/CmdLine.h"
+
+#include <algorithm>
+
+#include <commandlinecfg.h>
+#include <histogramstore.h>
+#include <parallel.h>
+
+/**
+ * Pack the histograms of all the input files of a configuration, and of their
+ * '<stem>__<variation>.root' friend files, into the stores read by plotIt --pack-dir.
+ *
+ * Stores already up to date are kept as is.
+ **/
+int main(int argc, char** argv) {
+
+  try {
+
+    TCLAP::CmdLine cmd("Pack the histograms of the input files of a configuration into memory-mapped stores", ' ', "0.1");
+
+    TCLAP::ValueArg<std::string> histogramsFolderArg("i", "histograms-folder", "histograms base folder (default: current directory)", false, "./", "string", cmd);
+
+    TCLAP::ValueArg<std::string> packFolderArg("o", "pack-dir", "folder where the stores are written", true, "", "string", cmd);
+
+    TCLAP::ValueArg<std::string> eraArg("e", "era", "era to restrict to", false, "", "string", cmd);
+
+    TCLAP::ValueArg<size_t> threadsArg("j", "threads", "Number of files packed in parallel (default: 1)", false, 1, "int", cmd);
+
+    TCLAP::SwitchArg verboseArg("v", "verbose", "Print the number of histograms packed for each file", cmd, false);
+
+    TCLAP::UnlabeledValueArg<std::string> configFileArg("configFile", "configuration file", true, "", "string", cmd);
+
+    cmd.parse(argc, argv);
+
+    fs::path histogramsPath(fs::canonical(histogramsFolderArg.getValue()));
+
+    fs::path packPath(packFolderArg.getValue());
+    fs::create_directories(packPath);
+
+    CommandLineCfg::get().era = eraArg.getValue();
+    CommandLineCfg::get().verbose = verboseArg.getValue();
+    CommandLineCfg::get().threads = std::max<size_t>(threadsArg.getValue(), 1);
+
+    if (CommandLineCfg::get().threads > 1)
+      ROOT::EnableThreadSafety();
+
+    plotIt::plotIt p(packPath);
+    if (!p.parseConfigurationFile(configFileArg.getValue(), histogramsPath))
+        return 1;
+
+    if (p.getConfiguration().mode == "tree") {
+      std::cerr << "Error: nothing to pack in tree mode" << std::endl;
+      return 1;
+    }
+
+    std::vector<std::string> inputs;
+    for (const auto& file: p.getFiles()) {
+      inputs.push_back(file.path);
+
+      // Shape systematics can be stored in friend files next to the nominal one
+      fs::path nominal(file.path);
+      std::string prefix = nominal.stem().string() + "__";
+
+      boost::system::error_code error;
+      for (fs::directory_iterator it(nominal.parent_path(), error), end; !error && it != end; ++it) {
+        std::string name = it->path().filename().string();
+        if (name.compare(0, prefix.size(), prefix) == 0 && it->path().extension() == ".root")
+          inputs.push_back(it->path().string());
+      }
+    }
+
+    std::vector<char> success(inputs.size(), false);
+    plotIt::parallel_for(inputs.size(), CommandLineCfg::get().threads, [&](size_t index) {
+      const std::string& input = inputs[index];
+
+      std::string store = plotIt::HistogramStore::path(packPath.string(), input);
+      if (store.empty()) {
+        std::cout << "Error: cannot pack '" << input << "', it is not a local file" << std::endl;
+        return;
+      }
+
+      // Stores written with another layout are packed again
+      if (plotIt::HistogramStore::open(store)) {
+        success[index] = true;
+        return;
+      }
+
+      int64_t packed = plotIt::HistogramStore::pack(input, store);
+      if (packed < 0) {
+        std::cout << "Error: failed to pack '" << input << "' into '" << store << "'" << std::endl;
+        return;
+      }
+
+      if (CommandLineCfg::get().verbose)
+        std::cout << "Packed " << packed << " histograms of '" << input << "'" << std::endl;
+
+      success[index] = true;
+    });
+
+    if (std::find(success.begin(), success.end(), false) != success.end())
+      return 1;
+
+  } catch (TCLAP::ArgException &e) {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,58 @@
+#include <parallel.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace plotIt {
+
+    namespace {
+        thread_local bool s_in_parallel_for = false;
+    }
+
+    void parallel_for(size_t size, size_t threads, const std::function<void(size_t)>& function) {
+
+        threads = std::min(threads, size);
+
+        if (threads <= 1 || s_in_parallel_for) {
+            for (size_t i = 0; i < size; i++)
+                function(i);
+
+            return;
+        }
+
+        std::atomic<size_t> next(0);
+        std::exception_ptr exception;
+        std::mutex exception_mutex;
+
+        auto worker = [&]() {
+            s_in_parallel_for = true;
+
+            size_t i;
+            while ((i = next++) < size) {
+                try {
+                    function(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(exception_mutex);
+                    if (! exception)
+                        exception = std::current_exception();
+                }
+            }
+
+            s_in_parallel_for = false;
+        };
+
+        std::vector<std::thread> pool;
+        for (size_t t = 0; t < threads; t++)
+            pool.emplace_back(worker);
+
+        for (auto& thread: pool)
+            thread.join();
+
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+}
@@ -1,12 +1,10 @@
 #include "plotIt.h"
 
-// For fnmatch()
-#include <fnmatch.h>
-
 #include <TROOT.h>
 #include <TList.h>
 #include <TCollection.h>
 #include <TCanvas.h>
+#include <TEnv.h>
 #include <TError.h>
 #include <TFile.h>
 #include <TKey.h>
@@ -18,25 +16,37 @@
 #include <TGaxis.h>
 #include <Math/QuantFuncMathCore.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <vector>
+#include <numeric>
 #include <map>
 #include <fstream>
 #include <sstream>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <iomanip>
 
-#include "tclap/CmdLine.h"
-
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
 
 #include <commandlinecfg.h>
+#include <entrylistcache.h>
+#include <expressioncompiler.h>
+#include <globmatcher.h>
+#include <histogramcache.h>
+#include <inputfilepool.h>
+#include <manifest.h>
+#include <parallel.h>
 #include <plotters.h>
 #include <pool.h>
 #include <summary.h>
 #include <systematics.h>
+#include <treefiller.h>
 #include <utilities.h>
 
 
@@ -453,6 +463,15 @@ namespace plotIt {
       if (node["tree-name"])
           m_config.tree_name = node["tree-name"].as<std::string>();
 
+      if (node["tree-cache-size"])
+          m_config.tree_cache_size = node["tree-cache-size"].as<int64_t>();
+
+      if (node["tree-cache-learn-entries"])
+          m_config.tree_cache_learn_entries = node["tree-cache-learn-entries"].as<int>();
+
+      if (node["tree-async-prefetch"])
+          m_config.tree_async_prefetch = node["tree-async-prefetch"].as<bool>();
+
       if (node["transparent-background"])
           m_config.transparent_background = node["transparent-background"].as<bool>();
 
@@ -585,6 +604,8 @@ namespace plotIt {
         }
     }
 
+    resolveSystematics();
+
     // Retrieve plots configuration
     if (! f["plots"]) {
       throw YAML::ParserException(YAML::Mark::null_mark(), "You must specify at least one plot in your configuration file");
@@ -753,6 +774,19 @@ namespace plotIt {
       if (node["selection-string"])
         plot.selection_string = node["selection-string"].as<std::string>();
 
+      if (m_config.mode == "tree" && plot.binning_y) {
+        std::string draw_x, draw_y;
+        if (! TreeFiller::splitDrawString(plot.draw_string, draw_x, draw_y))
+          throw YAML::ParserException(node["binning-y"].Mark(), "Plot '" + plot.name + "' has a binning-y, its draw-string must be of the form 'y:x'");
+
+        // Without a range, ROOT would choose the binning of each histogram from its first entries.
+        // The log range defaults to the linear one, and is used when the plot is in log scale
+        for (const Range& range: {plot.y_axis_range, plot.log_y_axis_range}) {
+          if (! range.valid() || range.start >= range.end)
+            throw YAML::ParserException(node["binning-y"].Mark(), "Plot '" + plot.name + "' has a binning-y, it must have a valid y-axis-range");
+        }
+      }
+
       if (node["for-yields"])
         plot.use_for_yields = node["for-yields"].as<bool>();
 
@@ -1063,13 +1097,22 @@ namespace plotIt {
       pt->SetTextSize(0.75 * topMargin);
       pt->SetTextAlign(13);
 
+      bool preview = (m_config.mode == "tree") && (CommandLineCfg::get().preview_fraction < 1);
+
       std::string text = m_config.experiment;
-      if (m_config.extra_label.length() || plot.extra_label.length()) {
+      if (m_config.extra_label.length() || plot.extra_label.length() || preview) {
         std::string extra_label = plot.extra_label;
         if (extra_label.length() == 0) {
           extra_label = m_config.extra_label;
         }
 
+        if (preview) {
+          boost::format preview_fmt("Preview (%g%%)");
+          preview_fmt % (100 * CommandLineCfg::get().preview_fraction);
+
+          extra_label = extra_label.empty() ? preview_fmt.str() : extra_label + " - " + preview_fmt.str();
+        }
+
         boost::format fmt("%s #font[52]{#scale[0.76]{%s}}");
         fmt % m_config.experiment % extra_label;
 
@@ -1188,7 +1231,8 @@ namespace plotIt {
 
         if ( file.type == DATA ){
           TH1* h = dynamic_cast<TH1*>(file.object);
-          data_yields[plot.yields_title] += h->Integral(0, h->GetNbinsX() + 1);
+          double error = 0;
+          data_yields[plot.yields_title] += integralAndError(h, error);
           has_data = true;
           continue;
         }
@@ -1226,23 +1270,20 @@ namespace plotIt {
         }
 
         // Retrieve yield and stat. error, taking overflow into account
-        yield_sqerror.first = hist->IntegralAndError(0, hist->GetNbinsX() + 1, yield_sqerror.second);
+        yield_sqerror.first = integralAndError(hist, yield_sqerror.second);
         yield_sqerror.second = std::pow(yield_sqerror.second, 2);
 
         // Add systematics
         double file_total_systematics = 0;
         for (auto& syst: *file.systematics) {
 
-          TH1* nominal_shape = static_cast<TH1*>(syst.nominal_shape.get());
-          TH1* up_shape = static_cast<TH1*>(syst.up_shape.get());
-          TH1* down_shape = static_cast<TH1*>(syst.down_shape.get());
-
-          if (! nominal_shape || ! up_shape || ! down_shape)
+          if (syst.nominal_shape.empty())
               continue;
 
-          double nominal_integral = nominal_shape->Integral(0, nominal_shape->GetNbinsX() + 1);
-          double up_integral = up_shape->Integral(0, up_shape->GetNbinsX() + 1);
-          double down_integral = down_shape->Integral(0, down_shape->GetNbinsX() + 1);
+          // Including underflow and overflow
+          double nominal_integral = std::accumulate(syst.nominal_shape.begin(), syst.nominal_shape.end(), 0.);
+          double up_integral = std::accumulate(syst.up_shape.begin(), syst.up_shape.end(), 0.);
+          double down_integral = std::accumulate(syst.down_shape.begin(), syst.down_shape.end(), 0.);
 
           double total_syst_error = std::max(
                   std::abs(up_integral - nominal_integral),
@@ -1561,7 +1602,9 @@ namespace plotIt {
       m_config.book_keeping_file.reset(TFile::Open(outputName.native().c_str(), "recreate"));
     }
 
-    constexpr std::size_t plots_per_chunk = 20;
+    // In tree mode, all the plots are filled in the same loop over the trees:
+    // use a single chunk so that each file is only read once
+    const std::size_t plots_per_chunk = (m_config.mode == "tree") ? plots.size() : 20;
 
     auto plots_begin = plots.begin();
     auto plots_end = plots.begin();
@@ -1576,9 +1619,12 @@ namespace plotIt {
       if (CommandLineCfg::get().verbose)
           std::cout << "Loading plots " << std::distance(plots.begin(), plots_begin) << "-" << std::distance(plots.begin(), plots_end) << " of " << plots.size() << "..." << std::endl;
 
-      for (File& file: m_files) {
-        if (! loadAllObjects(file, plots_begin, plots_end))
+      if (m_config.mode == "tree") {
+        if (! loadAllTreeObjects(plots_begin, plots_end))
             return;
+      } else {
+        if (! loadAllObjects(plots_begin, plots_end))
+          return;
       }
 
       if (CommandLineCfg::get().verbose)
@@ -1593,86 +1639,484 @@ namespace plotIt {
       if (CommandLineCfg::get().do_yields) {
         plotIt::yields(plots_begin, plots_end);
       }
-    }
 
-    for (File& file: m_files) {
-      file.handle.reset();
-      file.friend_handles.clear();
+      // The histograms of this chunk are not needed anymore
+      for (File& file: m_files) {
+        file.object = nullptr;
+        file.objects.clear();
+        file.systematics = nullptr;
+        file.systematics_cache.clear();
+      }
+
+      TemporaryPool::get().clearChunk();
     }
 
+    InputFilePool::get().clear();
+
     if (m_config.book_keeping_file) {
       m_config.book_keeping_file->Close();
       m_config.book_keeping_file.reset();
     }
   }
 
-  bool plotIt::loadAllObjects(File& file, std::vector<Plot>::const_iterator plots_begin, std::vector<Plot>::const_iterator plots_end) {
+  /**
+   * Load the objects of all the plots from all the files, and their systematic sets.
+   *
+   * The files are spread over `--threads` reader threads. Each reader opens its files, reads
+   * their keys in file order, and decompresses and deserializes their records itself: ROOT
+   * only allows one thread at a time to use a TFile and its directories.
+   * The systematic sets of each file are then built in parallel.
+   **/
+  bool plotIt::loadAllObjects(std::vector<Plot>::const_iterator plots_begin, std::vector<Plot>::const_iterator plots_end) {
 
-    file.object = nullptr;
-    file.objects.clear();
+    struct Loading {
+      std::vector<std::string> plot_names;
+      std::vector<std::shared_ptr<TObject>> objects;
+    };
 
-    if (m_config.mode == "tree") {
+    // Compressed records held by the readers, above which a reader waits before reading its next file
+    const int64_t MAX_BUFFERED_BYTES = 256 * 1024 * 1024;
+
+    size_t threads = CommandLineCfg::get().threads;
+    size_t max_files = CommandLineCfg::get().max_open_files;
+
+    std::vector<Loading> loadings(m_files.size());
+
+    // Files with the same path share the same InputFile, so they are read by the same reader
+    std::vector<std::vector<size_t>> groups;
+    {
+      std::unordered_map<std::string, size_t> group_of_path;
+      for (size_t i = 0; i < m_files.size(); i++) {
+        auto group = group_of_path.emplace(m_files[i].path, groups.size());
+        if (group.second)
+          groups.emplace_back();
 
-        if (!file.chain.get()) {
-          file.chain.reset(new TChain(m_config.tree_name.c_str()));
-          file.chain->Add(file.path.c_str());
+        groups[group.first->second].push_back(i);
+      }
+    }
+
+    // Files being read, and the size of their records
+    std::mutex flight_mutex;
+    std::condition_variable flight_done;
+    size_t files_in_flight = 0;
+    int64_t bytes_in_flight = 0;
+
+    std::atomic<bool> failed(false);
+
+    parallel_for(groups.size(), threads, [&](size_t group) {
+
+      // Keep at most max_files files open, and a bounded amount of records in memory
+      {
+        std::unique_lock<std::mutex> lock(flight_mutex);
+        flight_done.wait(lock, [&]() { return files_in_flight == 0 || (files_in_flight < max_files && bytes_in_flight < MAX_BUFFERED_BYTES); });
+        files_in_flight++;
+      }
+
+      // Records of the current file, not deserialized yet
+      int64_t bytes = 0;
+
+      auto release = [&]() {
+        {
+          std::lock_guard<std::mutex> lock(flight_mutex);
+          files_in_flight--;
+          bytes_in_flight -= bytes;
         }
 
-        for ( auto it = plots_begin; it != plots_end; ++it ) {
-          const auto& plot = *it;
+        flight_done.notify_all();
+      };
+
+      try {
+        std::shared_ptr<InputFile> input = InputFilePool::get().open(m_files[groups[group].front()].path);
+        if (! input) {
+          failed = true;
+          release();
+          return;
+        }
 
-          auto x_axis_range = plot.log_x ? plot.log_x_axis_range : plot.x_axis_range;
+        for (size_t i: groups[group]) {
+          File& file = m_files[i];
+          Loading& loading = loadings[i];
 
-          std::shared_ptr<TH1> hist(new TH1F((plot.uid + std::to_string(file.id)).c_str(), "", plot.binning_x, x_axis_range.start, x_axis_range.end));
-          hist->SetDirectory(gROOT);
+          file.object = nullptr;
+          file.objects.clear();
+          file.systematics_cache.clear();
 
-          file.chain->Draw((plot.draw_string + ">>" + plot.uid + std::to_string(file.id)).c_str(), plot.selection_string.c_str());
+          // Rename plot name according to user's transformations
+          for ( auto it = plots_begin; it != plots_end; ++it )
+            loading.plot_names.push_back(applyRenaming(file.renaming_ops, it->name));
 
-          hist->SetDirectory(nullptr);
-          
-          file.objects.emplace(plot.uid, hist.get());
+          loading.objects.resize(loading.plot_names.size());
+          std::vector<InputFile::Batch> batches = input->fetch(loading.plot_names, loading.objects);
 
-          TemporaryPool::get().addRuntime(hist);
+          int64_t file_bytes = 0;
+          for (const InputFile::Batch& batch: batches)
+            file_bytes += batch.buffer.size();
+
+          {
+            std::lock_guard<std::mutex> lock(flight_mutex);
+            bytes_in_flight += file_bytes;
+          }
+          bytes = file_bytes;
+
+          for (InputFile::Batch& batch: batches) {
+            for (size_t r = 0; r < batch.records.size(); r++)
+              loading.objects[batch.records[r].index] = InputFile::deserialize(batch, r);
+          }
+
+          std::vector<InputFile::Batch>().swap(batches);
+
+          {
+            std::lock_guard<std::mutex> lock(flight_mutex);
+            bytes_in_flight -= file_bytes;
+          }
+          bytes = 0;
+
+          flight_done.notify_all();
         }
+      } catch (...) {
+        release();
+        throw;
+      }
 
-        return true;
-    }
+      release();
+    });
 
-    if (! file.handle)
-      file.handle.reset(TFile::Open(file.path.c_str()));
-    if (! file.handle)
+    if (failed)
       return false;
 
-    file.systematics_cache.clear();
+    for (size_t i = 0; i < m_files.size(); i++) {
+      File& file = m_files[i];
+      Loading& loading = loadings[i];
+
+      size_t index = 0;
+      for ( auto it = plots_begin; it != plots_end; ++it, ++index ) {
+        const auto& plot = *it;
+
+        std::shared_ptr<TObject> obj = loading.objects[index];
+
+        if (! obj) {
+          std::cout << "Error: object '" << loading.plot_names[index] << "' inheriting from '" << plot.inherits_from << "' not found in file '" << file.path << "'" << std::endl;
+          return false;
+        }
 
+        TemporaryPool::get().addChunk(obj);
+
+        file.objects.emplace(plot.uid, obj.get());
+      }
+    }
+
+    // Files are independent: build their systematic sets in parallel
+    parallel_for(m_files.size(), threads, [&](size_t index) {
+      loadSystematics(m_files[index], plots_begin, plots_end);
+    });
+
+    return true;
+  }
+
+  void plotIt::loadSystematics(File& file, std::vector<Plot>::const_iterator plots_begin, std::vector<Plot>::const_iterator plots_end) {
+
+    const auto& applicable = file.applicable_systematics;
+    if (applicable.none())
+      return;
+
+    // Snapshots of the nominal histograms, taken before the plotter modifies them, shared by all the systematics.
+    // Shapes are 1D arrays: 2D plots have no systematic sets
+    std::vector<std::shared_ptr<const NominalShape>> nominals;
     for ( auto it = plots_begin; it != plots_end; ++it ) {
-      const auto& plot = *it;
+      const TH1* nominal = static_cast<const TH1*>(file.objects[it->uid]);
+      nominals.push_back((nominal->GetDimension() == 1) ? std::make_shared<NominalShape>(*nominal) : nullptr);
+    }
 
-      std::string plot_name = plot.name;
+    // One systematic at a time, so that the reads of the files of each shape systematic are grouped.
+    // The shapes are loaded now, in parallel, only for the plots which are going to use them,
+    // the others are loaded on demand
+    for (size_t i = applicable.find_first(); i != applicable.npos; i = applicable.find_next(i)) {
+      const auto& syst = m_systematics[i];
 
-      // Rename plot name according to user's transformations
-      plot_name = applyRenaming(file.renaming_ops, plot_name);
+      size_t index = 0;
+      for ( auto it = plots_begin; it != plots_end; ++it, ++index ) {
+        if (! nominals[index])
+          continue;
 
-      TObject* obj = file.handle->Get(plot_name.c_str());
+        std::vector<SystematicSet>& sets = file.systematics_cache[it->uid];
+        sets.push_back(syst->newSet(nominals[index], file, *it));
 
-      if (obj) {
-        std::shared_ptr<TObject> cloned_obj(obj->Clone());
-        TemporaryPool::get().addRuntime(cloned_obj);
+        if (needsSystematics(*it))
+          sets.back().load();
+      }
+    }
+  }
 
-        file.objects.emplace(plot.uid, cloned_obj.get());
+  /**
+   * The systematics are used for the error bands of the plots, their ratio and the summary
+   * printed with -b, and for the yields table
+   **/
+  bool plotIt::needsSystematics(const Plot& plot) const {
+    bool for_plots = CommandLineCfg::get().do_plots && plot.show_errors && ! plot.normalized;
+    bool for_yields = CommandLineCfg::get().do_yields && plot.use_for_yields;
+
+    return for_plots || for_yields;
+  }
+
+  /**
+   * Fill the histograms of all the plots from the trees of all the files.
+   *
+   * The entries of each file are split in cluster-aligned ranges, one per thread.
+   * Each range is filled into its own partial histograms, and the partials are then
+   * merged in the order of the ranges, so that the result does not depend on the
+   * scheduling of the threads.
+   *
+   * With --cache, histograms already filled by a previous run are read from the cache,
+   * and files for which all the histograms are cached are not read at all.
+   **/
+  bool plotIt::loadAllTreeObjects(std::vector<Plot>::const_iterator plots_begin, std::vector<Plot>::const_iterator plots_end) {
+
+    size_t threads = CommandLineCfg::get().threads;
 
-        if (file.type != DATA) {
-          for (auto& syst: m_systematics) {
-              if (std::regex_search(file.path, syst->on))
-                  file.systematics_cache[plot.uid].push_back(syst->newSet(cloned_obj.get(), file, plot));
+    // Must be set before the files are opened
+    if (m_config.tree_async_prefetch)
+      gEnv->SetValue("TFile.AsyncPrefetching", 1);
+
+    struct Task {
+      File* file;
+      int64_t first;
+      int64_t last;
+
+      std::shared_ptr<TChain> chain;
+      std::shared_ptr<TreeFiller> filler;
+
+      // Plots not found in the histogram cache, and their histograms
+      std::vector<const Plot*> plots;
+      std::vector<std::shared_ptr<TH1>> histograms;
+      double scale = 1;
+      bool success = false;
+    };
+
+    // Partial histograms and entry lists must not end up in the cache
+    bool preview = CommandLineCfg::get().preview_fraction < 1;
+    bool use_cache = CommandLineCfg::get().cache;
+    HistogramCache histogram_cache((m_outputPath / "plotIt_histograms").string());
+
+    std::vector<Task> tasks;
+    for (File& file: m_files) {
+      file.object = nullptr;
+      file.objects.clear();
+
+      // Histograms filled by a previous run do not need to be filled again
+      std::vector<const Plot*> plots;
+      if (use_cache) {
+        std::vector<std::string> keys;
+        for ( auto it = plots_begin; it != plots_end; ++it )
+          keys.push_back(HistogramCache::key(*it, m_config.tree_name));
+
+        auto cached = histogram_cache.load(file.path, keys);
+
+        size_t i = 0;
+        for ( auto it = plots_begin; it != plots_end; ++it, ++i ) {
+          if (! cached[i]) {
+            plots.push_back(&*it);
+            continue;
           }
+
+          cached[i]->SetName((it->uid + std::to_string(file.id)).c_str());
+          file.objects.emplace(it->uid, cached[i].get());
+
+          TemporaryPool::get().addChunk(cached[i]);
         }
+      } else {
+        for ( auto it = plots_begin; it != plots_end; ++it )
+          plots.push_back(&*it);
+      }
 
+      if (plots.empty())
         continue;
+
+      if (!file.chain.get()) {
+        file.chain.reset(new TChain(m_config.tree_name.c_str()));
+        file.chain->Add(file.path.c_str());
       }
 
-      std::cout << "Error: object '" << plot_name << "' inheriting from '" << plot.inherits_from << "' not found in file '" << file.path << "'" << std::endl;
-      return false;
+      // In preview mode, only the first clusters are read, and the histograms are scaled to the full number of entries
+      int64_t last = -1;
+      double scale = 1;
+      if (preview) {
+        last = TreeFiller::previewEnd(*file.chain, CommandLineCfg::get().preview_fraction);
+        if (last > 0)
+          scale = static_cast<double>(file.chain->GetEntries()) / last;
+      }
+
+      auto ranges = TreeFiller::split(*file.chain, threads, last);
+      if (ranges.empty()) {
+        // Empty chain: a single task to book empty histograms
+        ranges.emplace_back(0, 0);
+      }
+
+      for (const auto& range: ranges) {
+        Task task;
+        task.file = &file;
+        task.first = range.first;
+        task.last = range.second;
+        task.scale = scale;
+
+        // TChain are not thread-safe: each task needs its own
+        task.chain = file.chain;
+        if (threads > 1) {
+          task.chain.reset(new TChain(m_config.tree_name.c_str()));
+          task.chain->Add(file.path.c_str());
+        }
+
+        // Book all the histograms first, and fill them with a single loop over the chain
+        task.filler.reset(new TreeFiller(*task.chain));
+        task.filler->setCacheOptions(m_config.tree_cache_size, m_config.tree_cache_learn_entries);
+        task.plots = plots;
+
+        for (const Plot* plot: plots)
+          task.histograms.push_back(task.filler->book(*plot, plot->uid + std::to_string(file.id) + "_" + std::to_string(tasks.size())));
+
+        tasks.push_back(task);
+      }
+    }
+
+    // Build the compiled expressions from the main thread, the tasks then only have to look them up
+    if (CommandLineCfg::get().compile_expressions && !tasks.empty()) {
+      TChain& chain = *tasks.front().file->chain;
+      if (chain.LoadTree(0) >= 0) {
+        for ( auto it = plots_begin; it != plots_end; ++it ) {
+          ExpressionCompiler::get().compile(it->draw_string, *chain.GetTree());
+          if (! it->selection_string.empty())
+            ExpressionCompiler::get().compile(it->selection_string, *chain.GetTree());
+        }
+      }
+    }
+
+    // Entry lists of the selections from the previous runs. All the tasks of a file share the same
+    // selections, in the same order. Selections without a cached list are recorded during the filling.
+    struct CachedSelection {
+      std::string key;
+      std::shared_ptr<std::vector<int64_t>> entries;
+    };
+
+    EntryListCache entry_list_cache((m_outputPath / "plotIt_entrylists").string());
+    std::map<File*, std::vector<CachedSelection>> cached_selections;
+
+    if (use_cache) {
+      for (Task& task: tasks) {
+        auto& selections = cached_selections[task.file];
+
+        if (selections.empty()) {
+          for (size_t i = 0; i < task.filler->selections(); i++) {
+            CachedSelection selection;
+
+            // Nothing to gain for plots without selection
+            if (! task.filler->selection(i).empty()) {
+              selection.key = entry_list_cache.key(task.file->path, m_config.tree_name, task.filler->selection(i));
+              selection.entries.reset(new std::vector<int64_t>());
+              if (! entry_list_cache.load(selection.key, *selection.entries))
+                selection.entries.reset();
+            }
+
+            selections.push_back(selection);
+          }
+        }
+
+        for (size_t i = 0; i < selections.size(); i++) {
+          if (selections[i].entries)
+            task.filler->setEntryList(i, selections[i].entries);
+        }
+      }
+    }
+
+    parallel_for(tasks.size(), threads, [&](size_t index) {
+      Task& task = tasks[index];
+      task.success = task.filler->fill(task.first, task.last);
+    });
+
+    // Store the entry lists recorded by the tasks, concatenated in the order of the tasks
+    for (const auto& file_selections: cached_selections) {
+      if (preview)
+        break;
+
+      const auto& selections = file_selections.second;
+
+      for (size_t i = 0; i < selections.size(); i++) {
+        if (selections[i].key.empty() || selections[i].entries)
+          continue;
+
+        bool complete = true;
+        std::vector<int64_t> entries;
+        for (const Task& task: tasks) {
+          if (task.file != file_selections.first)
+            continue;
+
+          complete &= task.success;
+
+          const auto& selected = task.filler->selectedEntries(i);
+          entries.insert(entries.end(), selected.begin(), selected.end());
+        }
+
+        if (complete)
+          entry_list_cache.save(selections[i].key, entries);
+      }
+    }
+
+    // Merge partial histograms, in the order of the tasks
+    for (size_t index = 0; index < tasks.size(); index++) {
+      Task& task = tasks[index];
+      File& file = *task.file;
+
+      if (! task.success)
+        return false;
+
+      bool first_of_file = (index == 0) || (tasks[index - 1].file != task.file);
+
+      for (size_t i = 0; i < task.plots.size(); i++) {
+        const auto& plot = *task.plots[i];
+        auto& hist = task.histograms[i];
+
+        if (first_of_file) {
+          hist->SetName((plot.uid + std::to_string(file.id)).c_str());
+          file.objects.emplace(plot.uid, hist.get());
+
+          TemporaryPool::get().addChunk(hist);
+        } else {
+          static_cast<TH1*>(file.objects[plot.uid])->Add(hist.get());
+        }
+      }
+
+      bool last_of_file = (index == tasks.size() - 1) || (tasks[index + 1].file != task.file);
+
+      if (last_of_file && CommandLineCfg::get().verbose) {
+        TreeFiller::ReadStatistics statistics;
+        for (size_t i = index + 1; i-- > 0 && tasks[i].file == task.file; ) {
+          const auto& task_statistics = tasks[i].filler->statistics();
+          statistics.read_calls += task_statistics.read_calls;
+          statistics.bytes_read += task_statistics.bytes_read;
+          statistics.cache_efficiency_sum += task_statistics.cache_efficiency_sum;
+          statistics.caches += task_statistics.caches;
+        }
+
+        std::cout << "File '" << file.path << "': " << statistics.read_calls << " read calls, "
+                  << statistics.bytes_read / (1024. * 1024.) << " MB read";
+        if (statistics.caches)
+          std::cout << ", tree cache efficiency " << 100 * statistics.cache_efficiency_sum / statistics.caches << "%";
+        std::cout << std::endl;
+      }
+
+      if (last_of_file && task.scale != 1) {
+        for (const Plot* plot: task.plots)
+          static_cast<TH1*>(file.objects[plot->uid])->Scale(task.scale);
+      }
+
+      if (use_cache && last_of_file && !preview) {
+        std::vector<std::string> keys;
+        std::vector<TH1*> histograms;
+        for (const Plot* plot: task.plots) {
+          keys.push_back(HistogramCache::key(*plot, m_config.tree_name));
+          histograms.push_back(static_cast<TH1*>(file.objects[plot->uid]));
+        }
+
+        histogram_cache.save(file.path, keys, histograms);
+      }
     }
 
     return true;
@@ -1716,9 +2160,29 @@ namespace plotIt {
 
     m_files = files;
 
+    // The systematics are parsed after the files, this is a no-op during the parsing
+    resolveSystematics();
+
     return true;
   }
 
+  /**
+   * Find once which systematics apply to each file. Must be called again each time
+   * the list of files or of systematics changes
+   **/
+  void plotIt::resolveSystematics() {
+    for (File& file: m_files) {
+      file.applicable_systematics.clear();
+      file.applicable_systematics.resize(m_systematics.size());
+
+      if (file.type == DATA)
+        continue;
+
+      for (size_t i = 0; i < m_systematics.size(); i++)
+        file.applicable_systematics[i] = std::regex_search(file.path, m_systematics[i]->on);
+    }
+  }
+
   /**
    * Merge the labels of the global configuration and the current plot.
    * If some are duplicated, only keep the plot label
@@ -1744,35 +2208,67 @@ namespace plotIt {
     return labels;
   }
 
-  void get_directory_content(TDirectory* root, const std::string& prefix, std::vector<std::string>& content) {
-      TIter it(root->GetListOfKeys());
-      TKey* key = nullptr;
-
-      while ((key = static_cast<TKey*>(it()))) {
-          std::string name = key->GetName();
-          std::string cl = key->GetClassName();
-
-          if (cl.find("TDirectory") != std::string::npos) {
-              std::string new_prefix = prefix;
-              if (!prefix.empty())
-                  new_prefix += "/";
-              new_prefix += name;
-              get_directory_content(static_cast<TDirectory*>(key->ReadObj()), new_prefix, content);
-          } else if (cl.find("TH") != std::string::npos) {
-              if (name.find("__") != std::string::npos) {
-                  // TODO: Maybe we should be a bit less strict and check that the
-                  // systematics specified is included in the configuration file?
-                  continue;
-              }
+  void get_directory_content(InputFile& input, std::vector<std::string>& content) {
+      for (const auto& entry: input.entries()) {
+          if (entry.class_name.find("TH") == std::string::npos)
+              continue;
 
-              std::string new_prefix = prefix;
-              if (!new_prefix.empty())
-                  new_prefix += "/";
-              content.push_back(new_prefix + name);
+          std::string name = entry.path.substr(entry.path.rfind('/') + 1);
+          if (name.find("__") != std::string::npos) {
+              // TODO: Maybe we should be a bit less strict and check that the
+              // systematics specified is included in the configuration file?
+              continue;
           }
+
+          content.push_back(entry.path);
       }
   }
 
+  /**
+   * List the histograms of all the input files. The content of the files which did not change since
+   * the previous run is read from the manifest, the other files are scanned in parallel.
+   */
+  bool plotIt::listAllFilesContent(std::map<const File*, std::vector<std::string>>& contents) {
+    Manifest manifest((m_outputPath / "plotIt_manifest.yml").string());
+    manifest.load();
+
+    std::vector<File*> to_scan;
+    for (File& file: m_files) {
+      const std::vector<std::string>* content = manifest.content(file.path);
+      if (content)
+        contents[&file] = *content;
+      else
+        to_scan.push_back(&file);
+    }
+
+    std::vector<std::vector<std::string>> scanned(to_scan.size());
+    std::vector<char> success(to_scan.size(), false);
+    parallel_for(to_scan.size(), CommandLineCfg::get().threads, [&](size_t index) {
+      File& file = *to_scan[index];
+
+      std::shared_ptr<InputFile> input = InputFilePool::get().open(file.path);
+      if (! input)
+        return;
+
+      get_directory_content(*input, scanned[index]);
+      success[index] = true;
+    });
+
+    for (size_t i = 0; i < to_scan.size(); i++) {
+      if (! success[i]) {
+        std::cout << "Error: cannot open file '" << to_scan[i]->path << "'" << std::endl;
+        return false;
+      }
+
+      manifest.setContent(to_scan[i]->path, scanned[i]);
+      contents[to_scan[i]] = scanned[i];
+    }
+
+    manifest.save();
+
+    return true;
+  }
+
   /**
    * Open 'file', and expand all plots
    */
@@ -1795,47 +2291,70 @@ namespace plotIt {
         return true;
     }
 
-    std::shared_ptr<TFile> input(TFile::Open(file.path.c_str()));
-    if (! input.get())
-      return false;
-
     // Create file structure, flattening any directory
-    TIter root_keys(input->GetListOfKeys());
+    std::map<const File*, std::vector<std::string>> contents;
+    if (CommandLineCfg::get().cache) {
+      if (! listAllFilesContent(contents))
+        return false;
+    } else {
+      // The file stays in the pool: its key index is then reused when loading the objects
+      std::shared_ptr<InputFile> input = InputFilePool::get().open(file.path);
+      if (! input)
+        return false;
 
-    std::vector<std::string> file_content;
-    get_directory_content(input.get(), "", file_content);
+      get_directory_content(*input, contents[&file]);
+    }
 
-    for (Plot& plot: glob_plots) {
-        bool match = false;
-        std::vector<std::string> matched;
+    const std::vector<std::string>& file_content = contents[&file];
 
-        for (const auto& content: file_content) {
+    // Compile all the patterns once, and dispatch each key of the file to the patterns matching it
+    GlobMatcher matcher;
+    for (const Plot& plot: glob_plots)
+        matcher.add(plot.name, plot.exclude);
 
-            // Check name
-            if (fnmatch(plot.name.c_str(), content.c_str(), FNM_CASEFOLD) == 0) {
+    std::vector<std::vector<std::string>> matched(glob_plots.size());
+    std::unordered_set<std::string> seen;
+    std::vector<size_t> matches;
 
-                // Check if this name is excluded
-                if ((plot.exclude.length() > 0) && (fnmatch(plot.exclude.c_str(), content.c_str(), FNM_CASEFOLD) == 0)) {
-                    continue;
-                }
+    for (const auto& content: file_content) {
+        // The same object can be stored multiple time with a different key
+        // The iterator returns first the object with the highest key, which is the most recent object
+        if (! seen.insert(content).second)
+            continue;
 
-                // The same object can be stored multiple time with a different key
-                // The iterator returns first the object with the highest key, which is the most recent object
-                // Check if we already have a plot with the same exact name
-                if (std::find_if(matched.begin(), matched.end(), [&content](const std::string& p) { return p == content; }) != matched.end()) {
-                    continue;
-                }
+        matcher.match(content, matches);
+        for (size_t index: matches)
+            matched[index].push_back(content);
+    }
 
-                // Got it!
-                match = true;
-                matched.push_back(content);
-                plots.push_back(plot.Clone(content));
-            }
-        }
+    for (size_t i = 0; i < glob_plots.size(); i++) {
+        Plot& plot = glob_plots[i];
 
-        if (! match) {
+        if (matched[i].empty()) {
             std::cout << "Warning: object '" << plot.name << "' inheriting from '" << plot.inherits_from << "' does not match something in file '" << file.path << "'" << std::endl;
+            continue;
         }
+
+        for (const auto& content: matched[i])
+            plots.push_back(plot.Clone(content));
+    }
+
+    // When the content of all the files is known, report now the expanded objects missing from the other files
+    size_t first_glob_plot = m_plots.size() - glob_plots.size();
+    for (const auto& other: contents) {
+      const File& other_file = *other.first;
+      if (&other_file == &file)
+        continue;
+
+      std::unordered_set<std::string> other_content(other.second.begin(), other.second.end());
+      for (size_t i = first_glob_plot; i < plots.size(); i++) {
+        std::string plot_name = applyRenaming(other_file.renaming_ops, plots[i].name);
+
+        if (! other_content.count(plot_name)) {
+          std::cout << "Error: object '" << plot_name << "' inheriting from '" << plots[i].inherits_from << "' not found in file '" << other_file.path << "'" << std::endl;
+          return false;
+        }
+      }
     }
 
     if (!plots.size()) {
@@ -1854,73 +2373,3 @@ namespace plotIt {
     }
   }
 }
-
-int main(int argc, char** argv) {
-
-  try {
-
-    TCLAP::CmdLine cmd("Plot histograms", ' ', "0.1");
-
-    TCLAP::ValueArg<std::string> histogramsFolderArg("i", "histograms-folder", "histograms base folder (default: current directory)", false, "./", "string", cmd);
-
-    TCLAP::ValueArg<std::string> outputFolderArg("o", "output-folder", "output folder", true, "", "string", cmd);
-
-    TCLAP::ValueArg<std::string> eraArg("e", "era", "era to restrict to", false, "", "string", cmd);
-
-    TCLAP::SwitchArg ignoreScaleArg("", "ignore-scales", "Ignore any scales present in the configuration file", cmd, false);
-
-    TCLAP::SwitchArg verboseArg("v", "verbose", "Verbose output (print summary)", cmd, false);
-
-    TCLAP::SwitchArg yieldsArg("y", "yields", "Produce LaTeX table of yields", cmd, false);
-
-    TCLAP::SwitchArg plotsArg("p", "plots", "Do not produce the plots - can be useful if only the yields table is needed", cmd, false);
-
-    TCLAP::SwitchArg unblindArg("u", "unblind", "Unblind the plots, ie ignore any blinded-range in the configuration", cmd, false);
-
-    TCLAP::SwitchArg systematicsBreakdownArg("b", "systs-breadown", "Print systematics details for each MC process separately in addition to the total contribution", cmd, false);
-
-    TCLAP::UnlabeledValueArg<std::string> configFileArg("configFile", "configuration file", true, "", "string", cmd);
-
-    cmd.parse(argc, argv);
-
-    //bool isData = dataArg.isSet();
-
-    fs::path histogramsPath(fs::canonical(histogramsFolderArg.getValue()));
-
-    if (! fs::exists(histogramsPath)) {
-      std::cout << "Error: histograms path " << histogramsPath << " does not exist" << std::endl;
-    }
-
-    fs::path outputPath(outputFolderArg.getValue());
-
-    if (! fs::exists(outputPath)) {
-      std::cout << "Error: output path " << outputPath << " does not exist" << std::endl;
-      return 1;
-    }
-
-    if( plotsArg.getValue() && !yieldsArg.getValue() ) {
-      std::cerr << "Error: we have nothing to do" << std::endl;
-      return 1;
-    }
-
-    CommandLineCfg::get().era = eraArg.getValue();
-    CommandLineCfg::get().ignore_scales = ignoreScaleArg.getValue();
-    CommandLineCfg::get().verbose = verboseArg.getValue();
-    CommandLineCfg::get().do_plots = !plotsArg.getValue();
-    CommandLineCfg::get().do_yields = yieldsArg.getValue();
-    CommandLineCfg::get().unblind = unblindArg.getValue();
-    CommandLineCfg::get().systematicsBreakdown = systematicsBreakdownArg.getValue();
-
-    plotIt::plotIt p(outputPath);
-    if (!p.parseConfigurationFile(configFileArg.getValue(), histogramsPath))
-        return 1;
-
-    p.plotAll();
-
-  } catch (TCLAP::ArgException &e) {
-    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
-    return 1;
-  }
-
-  return 0;
-}
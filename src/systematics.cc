@@ -1,3 +1,4 @@
+#include <inputfilepool.h>
 #include <systematics.h>
 #include <types.h>
 #include <utilities.h>
@@ -8,47 +9,135 @@
 #include <TH1.h>
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 
-#include <boost/filesystem.hpp>
+namespace plotIt {
+    namespace {
+        std::shared_ptr<const SystematicSet::Shape> contents(const TH1& hist) {
+            std::shared_ptr<SystematicSet::Shape> shape = std::make_shared<SystematicSet::Shape>(hist.GetNcells());
+            for (size_t i = 0; i < shape->size(); i++)
+                (*shape)[i] = hist.GetBinContent(i);
+
+            return shape;
+        }
 
-namespace fs = boost::filesystem;
+        std::vector<double> edges(const TAxis& axis) {
+            std::vector<double> result(axis.GetNbins() + 1);
+            for (size_t i = 0; i < result.size(); i++)
+                result[i] = axis.GetBinLowEdge(i + 1);
 
-namespace plotIt {
-    SystematicSet::SystematicSet(Systematic& parent):
-        parent(&parent) {
+            return result;
+        }
+
+        bool sameEdges(const std::vector<double>& a, const std::vector<double>& b) {
+            if (a.size() != b.size())
+                return false;
+
+            for (size_t i = 0; i < a.size(); i++) {
+                if (std::abs(a[i] - b[i]) > 1e-6 * std::max(std::abs(a[i]), std::abs(b[i])))
+                    return false;
+            }
+
+            return true;
+        }
+
+        void scaleShape(SystematicSet::Shape& shape, double factor) {
+            for (double& content: shape)
+                content *= factor;
+        }
+    }
 
+    NominalShape::NominalShape(const TH1& hist):
+        contents(::plotIt::contents(hist)), dimension(hist.GetDimension()) {
+
+        edges[0] = ::plotIt::edges(*hist.GetXaxis());
+        edges[1] = ::plotIt::edges(*hist.GetYaxis());
+        edges[2] = ::plotIt::edges(*hist.GetZaxis());
+    }
+
+    bool NominalShape::sameBinning(const TH1& hist) const {
+        return hist.GetDimension() == dimension &&
+            sameEdges(::plotIt::edges(*hist.GetXaxis()), edges[0]) &&
+            sameEdges(::plotIt::edges(*hist.GetYaxis()), edges[1]) &&
+            sameEdges(::plotIt::edges(*hist.GetZaxis()), edges[2]);
+    }
+
+    SystematicSet::SystematicSet(Systematic& parent, std::shared_ptr<const NominalShape> nominal, File& file, const Plot& plot):
+        parent(&parent), nominal(nominal), file(&file), plot(&plot) {
+
+    }
+
+    void SystematicSet::load() {
+        if (loaded)
+            return;
+
+        parent->load(*this, *file, *plot);
+        loaded = true;
     }
 
     void SystematicSet::update() {
+        load();
+
         parent->apply(*this);
     }
 
     void SystematicSet::scale(float factor) {
-        if (nominal_shape) {
-            static_cast<TH1*>(nominal_shape.get())->Scale(factor);
-        }
+        scaleShape(nominal_shape, factor);
+        scaleShape(up_shape, factor);
+        scaleShape(down_shape, factor);
+    }
 
-        if (up_shape) {
-            static_cast<TH1*>(up_shape.get())->Scale(factor);
-        }
+    void SystematicSet::rebin(size_t factor) {
+        if (factor <= 1 || nominal_shape.size() < 2)
+            return;
+
+        size_t bins = nominal_shape.size() - 2;
+        size_t new_bins = bins / factor;
+
+        // Same as TH1::Rebin: the bins left when `bins` is not a multiple of `factor` go to the overflow
+        for (Shape* shape: {&nominal_shape, &up_shape, &down_shape}) {
+            if (shape->size() != bins + 2)
+                continue;
+
+            Shape& s = *shape;
+            for (size_t bin = 1; bin <= new_bins; bin++) {
+                double content = 0;
+                for (size_t i = 0; i < factor; i++)
+                    content += s[(bin - 1) * factor + 1 + i];
+
+                s[bin] = content;
+            }
+
+            double overflow = 0;
+            for (size_t i = new_bins * factor + 1; i <= bins + 1; i++)
+                overflow += s[i];
 
-        if (down_shape) {
-            static_cast<TH1*>(down_shape.get())->Scale(factor);
+            s[new_bins + 1] = overflow;
+            s.resize(new_bins + 2);
         }
     }
 
-    void SystematicSet::rebin(size_t factor) {
-        if (nominal_shape) {
-            static_cast<TH1*>(nominal_shape.get())->Rebin(factor);
-        }
+    void SystematicSet::addOverflow(size_t first_bin, size_t last_bin) {
+        for (Shape* shape: {&nominal_shape, &up_shape, &down_shape}) {
+            Shape& s = *shape;
+            if (last_bin >= s.size() || first_bin > last_bin)
+                continue;
 
-        if (up_shape) {
-            static_cast<TH1*>(up_shape.get())->Rebin(factor);
-        }
+            double underflow = 0;
+            for (size_t i = 0; i < first_bin; i++) {
+                underflow += s[i];
+                s[i] = 0;
+            }
 
-        if (down_shape) {
-            static_cast<TH1*>(down_shape.get())->Rebin(factor);
+            double overflow = 0;
+            for (size_t i = last_bin + 1; i < s.size(); i++) {
+                overflow += s[i];
+                s[i] = 0;
+            }
+
+            s[first_bin] += underflow;
+            s[last_bin] += overflow;
         }
     }
 
@@ -60,19 +149,20 @@ namespace plotIt {
         return parent->pretty_name;
     }
 
-    SystematicSet Systematic::newSet(TObject* nominal, File& file, const Plot& plot) {
-        SystematicSet s = SystematicSet(*this);
-        s.true_nominal_shape.reset(nominal->Clone());
-        s.true_up_shape.reset(nominal->Clone());
-        s.true_down_shape.reset(nominal->Clone());
+    SystematicSet Systematic::newSet(std::shared_ptr<const NominalShape> nominal, File& file, const Plot& plot) {
+        return SystematicSet(*this, nominal, file, plot);
+    }
 
-        return s;
+    void Systematic::load(SystematicSet& systs, File& file, const Plot& plot) {
+        systs.true_nominal_shape = systs.nominal->contents;
+        systs.true_up_shape = systs.true_nominal_shape;
+        systs.true_down_shape = systs.true_nominal_shape;
     }
 
     void Systematic::apply(SystematicSet& systs) {
-        systs.nominal_shape.reset(systs.true_nominal_shape->Clone());
-        systs.up_shape.reset(systs.true_up_shape->Clone());
-        systs.down_shape.reset(systs.true_down_shape->Clone());
+        systs.nominal_shape = *systs.true_nominal_shape;
+        systs.up_shape = *systs.true_up_shape;
+        systs.down_shape = *systs.true_down_shape;
     }
 
     ConstantSystematic::ConstantSystematic(const YAML::Node& node) {
@@ -87,11 +177,8 @@ namespace plotIt {
     void ConstantSystematic::apply(SystematicSet& systs) {
         Systematic::apply(systs);
 
-        TH1* up = static_cast<TH1*>(systs.up_shape.get());
-        TH1* down = static_cast<TH1*>(systs.down_shape.get());
-
-        up->Scale(value);
-        down->Scale(2 - value);
+        scaleShape(systs.up_shape, value);
+        scaleShape(systs.down_shape, 2 - value);
     }
 
     LogNormalSystematic::LogNormalSystematic(const YAML::Node& node) {
@@ -124,11 +211,8 @@ namespace plotIt {
     void LogNormalSystematic::apply(SystematicSet& systs) {
         Systematic::apply(systs);
 
-        TH1* up = static_cast<TH1*>(systs.up_shape.get());
-        TH1* down = static_cast<TH1*>(systs.down_shape.get());
-
-        up->Scale(value_up);
-        down->Scale(value_down);
+        scaleShape(systs.up_shape, value_up);
+        scaleShape(systs.down_shape, value_down);
     }
 
     void LogNormalSystematic::eval() {
@@ -141,9 +225,9 @@ namespace plotIt {
 
     }
 
-    SystematicSet ShapeSystematic::newSet(TObject* nominal, File& file, const Plot& plot) {
+    void ShapeSystematic::load(SystematicSet& result, File& file, const Plot& plot) {
 
-        auto result = Systematic::newSet(nominal, file, plot);
+        Systematic::load(result, file, plot);
 
         // We need to find the up and down shape
         // Two possibilities:
@@ -151,44 +235,56 @@ namespace plotIt {
         //   - we look for two objects named <nominal> in the file <nominal>__<systematic>[up|down].root
 
         std::array<Variation, 2> variations = {UP, DOWN};
-        std::map<Variation, std::shared_ptr<TObject>*> links = {{UP, &result.true_up_shape}, {DOWN, &result.true_down_shape}};
+        std::map<Variation, std::shared_ptr<const SystematicSet::Shape>*> links = {{UP, &result.true_up_shape}, {DOWN, &result.true_down_shape}};
+
+        // Variations with a different binning than the nominal histogram are replaced by the nominal shape
+        auto shape = [this, &result](const TObject* object, const std::string& object_name, const std::string& path) -> std::shared_ptr<const SystematicSet::Shape> {
+            const TH1* hist = dynamic_cast<const TH1*>(object);
+            if (! hist || ! result.nominal->sameBinning(*hist)) {
+                std::cout << "Warning: systematic '" << name << "': object '" << object_name << "' in file '" << path << "' does not have the binning of the nominal histogram, using the nominal shape instead" << std::endl;
+                return result.true_nominal_shape;
+            }
+
+            return contents(*hist);
+        };
 
         auto formatSystematicsName = [this](Variation variation) {
-            static std::map<Variation, std::string> names = {{UP, "up"}, {DOWN, "down"}};
-            return "__" + this->name + names[variation];
+            static const std::map<Variation, std::string> names = {{UP, "up"}, {DOWN, "down"}};
+            return "__" + this->name + names.at(variation);
         };
 
+        std::shared_ptr<InputFile> input = InputFilePool::get().open(file.path);
+
+        // Only one thread loads the systematics of a given file
+        if (! file.variations)
+            file.variations = std::make_shared<VariationIndex>(file.path);
+
         for (const auto& variation: variations) {
             std::string object_postfix = formatSystematicsName(variation);
 
             std::string object_name = applyRenaming(file.renaming_ops, plot.name) + object_postfix;
-            TObject* object = file.handle->Get(object_name.c_str());
+            std::shared_ptr<TObject> object;
+            if (input)
+                object = input->read(object_name);
 
             if (object) {
-                links[variation]->reset(object->Clone());
+                *links[variation] = shape(object.get(), object_name, file.path);
                 continue;
             }
 
-            auto nominal_path = fs::path(file.path);
-            auto syst_path = nominal_path.parent_path();
-            syst_path /= nominal_path.stem();
-            syst_path += object_postfix;
-            syst_path += ".root";
+            const std::string& syst_path = file.variations->friendFile(object_postfix);
+            if (syst_path.empty())
+                continue;
 
-            if (fs::exists(syst_path)) {
-                std::shared_ptr<TFile>& f = file.friend_handles[syst_path.native()];
-                if (! f)
-                    f.reset(TFile::Open(syst_path.native().c_str()));
+            std::shared_ptr<InputFile> f = InputFilePool::get().open(syst_path);
 
-                object = f->Get(plot.name.c_str());
+            if (f)
+                object = f->read(plot.name);
 
-                if (object) {
-                    links[variation]->reset(object->Clone());
-                }
+            if (object) {
+                *links[variation] = shape(object.get(), plot.name, syst_path);
             }
         }
-
-        return result;
     }
 
     std::shared_ptr<Systematic> SystematicFactory::create(const std::string& name, const std::string& type, const YAML::Node& node) {
@@ -0,0 +1,684 @@
+#include <commandlinecfg.h>
+#include <expressioncompiler.h>
+#include <treefiller.h>
+#include <types.h>
+#include <utilities.h>
+
+#include <TBranch.h>
+#include <TChain.h>
+#include <TFile.h>
+#include <TH1.h>
+#include <TH2.h>
+#include <TLeaf.h>
+#include <TTreeCache.h>
+#include <TTreeFormula.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <set>
+
+namespace plotIt {
+
+    TreeFiller::TreeFiller(TChain& chain):
+        m_chain(chain) {
+
+    }
+
+    TreeFiller::~TreeFiller() {
+        clearFormulas();
+    }
+
+    namespace {
+        // Formula parsing is not thread-safe, only the evaluation is
+        std::mutex s_compile_mutex;
+    }
+
+    std::shared_ptr<TH1> TreeFiller::book(const Plot& plot, const std::string& name) {
+        auto x_axis_range = plot.log_x ? plot.log_x_axis_range : plot.x_axis_range;
+
+        Booking booking;
+
+        std::string draw_x, draw_y;
+        if (plot.binning_y && splitDrawString(plot.draw_string, draw_x, draw_y)) {
+            auto y_axis_range = plot.log_y ? plot.log_y_axis_range : plot.y_axis_range;
+
+            TH2* hist2d = new TH2F(name.c_str(), "", plot.binning_x, x_axis_range.start, x_axis_range.end,
+                    plot.binning_y, y_axis_range.start, y_axis_range.end);
+
+            booking.hist.reset(hist2d);
+            booking.hist2d = hist2d;
+            booking.draw.string = draw_x;
+            booking.draw_y.string = draw_y;
+        } else {
+            booking.hist.reset(new TH1F(name.c_str(), "", plot.binning_x, x_axis_range.start, x_axis_range.end));
+            booking.draw.string = plot.draw_string;
+        }
+
+        std::shared_ptr<TH1> hist = booking.hist;
+        hist->SetDirectory(nullptr);
+
+        m_bookings.push_back(booking);
+
+        // Selections differing only by their formatting are shared. The expression evaluated is
+        // the one of the first plot, as written
+        std::string key = normalizeExpression(plot.selection_string);
+        auto selection = std::find_if(m_selections.begin(), m_selections.end(), [&key](const Selection& s) {
+                return s.key == key;
+            });
+
+        if (selection == m_selections.end()) {
+            Selection s;
+            s.key = key;
+            s.expression.string = key.empty() ? "" : plot.selection_string;
+            selection = m_selections.insert(m_selections.end(), s);
+        }
+
+        selection->bookings.push_back(m_bookings.size() - 1);
+
+        return hist;
+    }
+
+    const std::string& TreeFiller::selection(size_t index) const {
+        return m_selections[index].key;
+    }
+
+    void TreeFiller::setEntryList(size_t index, std::shared_ptr<const std::vector<int64_t>> entries) {
+        m_selections[index].entry_list = entries;
+    }
+
+    const std::vector<int64_t>& TreeFiller::selectedEntries(size_t index) const {
+        return m_selections[index].selected;
+    }
+
+    bool TreeFiller::compile(Expression& expression, const std::string& name) {
+        if (CommandLineCfg::get().compile_expressions) {
+            expression.kernel = ExpressionCompiler::get().compile(expression.string, *m_chain.GetTree());
+
+            if (expression.kernel) {
+                expression.inputs.clear();
+                for (const auto& input_name: expression.kernel->inputs) {
+                    auto input = std::find_if(m_inputs.begin(), m_inputs.end(), [&input_name](const Input& i) {
+                            return i.name == input_name;
+                        });
+
+                    if (input == m_inputs.end()) {
+                        Input i;
+                        i.name = input_name;
+                        input = m_inputs.insert(m_inputs.end(), i);
+                    }
+
+                    expression.inputs.push_back(input - m_inputs.begin());
+                }
+
+                expression.values.resize(expression.inputs.size());
+
+                return true;
+            }
+        }
+
+        return compileFormula(expression, name);
+    }
+
+    bool TreeFiller::compileFormula(Expression& expression, const std::string& name) {
+        expression.kernel = nullptr;
+        expression.inputs.clear();
+        expression.values.clear();
+
+        expression.formula = new TTreeFormula(name.c_str(), expression.string.c_str(), &m_chain);
+
+        return expression.formula->GetNdim() != 0;
+    }
+
+    bool TreeFiller::compile() {
+        for (auto& booking: m_bookings) {
+            std::string name = booking.hist->GetName();
+
+            if (! compile(booking.draw, name + "_draw")) {
+                std::cout << "Error: invalid draw string '" << booking.draw.string << "'" << std::endl;
+                return false;
+            }
+
+            if (booking.hist2d && ! compile(booking.draw_y, name + "_draw_y")) {
+                std::cout << "Error: invalid draw string '" << booking.draw_y.string << "'" << std::endl;
+                return false;
+            }
+        }
+
+        for (size_t i = 0; i < m_selections.size(); i++) {
+            auto& selection = m_selections[i];
+            if (selection.expression.string.empty())
+                continue;
+
+            std::string name = m_bookings[selection.bookings.front()].hist->GetName();
+
+            if (! compile(selection.expression, name + "_selection_" + std::to_string(i))) {
+                std::cout << "Error: invalid selection string '" << selection.expression.string << "'" << std::endl;
+                return false;
+            }
+        }
+
+        return updateInputs();
+    }
+
+    void TreeFiller::clearFormulas() {
+        auto clear = [](Expression& expression) {
+            delete expression.formula;
+            expression.formula = nullptr;
+            expression.kernel = nullptr;
+        };
+
+        for (auto& booking: m_bookings) {
+            clear(booking.draw);
+            clear(booking.draw_y);
+        }
+
+        for (auto& selection: m_selections)
+            clear(selection.expression);
+
+        m_inputs.clear();
+    }
+
+    bool TreeFiller::updateInputs() {
+        for (auto& input: m_inputs) {
+            input.leaf = m_chain.GetTree()->GetLeaf(input.name.c_str());
+            input.entry = -1;
+
+            if (! input.leaf) {
+                std::cout << "Error: leaf '" << input.name << "' not found in tree '" << m_chain.GetName() << "'" << std::endl;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool TreeFiller::checkKernels() {
+        bool fallback = false;
+        bool success = true;
+
+        auto check = [this, &fallback, &success](Expression& expression, const std::string& name) {
+            if (! expression.kernel)
+                return;
+
+            for (size_t input: expression.inputs) {
+                if (ExpressionCompiler::isScalarLeaf(m_inputs[input].leaf))
+                    continue;
+
+                std::cout << "Warning: leaf '" << m_inputs[input].name << "' is not a scalar in file '" << m_chain.GetCurrentFile()->GetName()
+                    << "', evaluating '" << expression.string << "' with TTreeFormula" << std::endl;
+
+                std::lock_guard<std::mutex> lock(s_compile_mutex);
+                success &= compileFormula(expression, name);
+                fallback = true;
+
+                return;
+            }
+        };
+
+        for (auto& booking: m_bookings) {
+            std::string name = booking.hist->GetName();
+
+            check(booking.draw, name + "_draw");
+            check(booking.draw_y, name + "_draw_y");
+        }
+
+        for (size_t i = 0; i < m_selections.size(); i++) {
+            std::string name = m_bookings[m_selections[i].bookings.front()].hist->GetName();
+            check(m_selections[i].expression, name + "_selection_" + std::to_string(i));
+        }
+
+        // The new formulas may read other branches
+        if (fallback)
+            activateBranches();
+
+        return success;
+    }
+
+    void TreeFiller::activateBranches() {
+        std::set<std::string> branches;
+        std::set<std::string> aliases;
+
+        auto add = [&branches](TLeaf* leaf) {
+            branches.emplace(leaf->GetBranch()->GetName());
+
+            // Size of variable-length arrays
+            if (leaf->GetLeafCount())
+                branches.emplace(leaf->GetLeafCount()->GetBranch()->GetName());
+        };
+
+        // Aliases defined by an expression are evaluated by sub-formulas, whose leaves are not listed
+        // by the formula: look for the leaves in the text of the aliases instead
+        auto is_name = [](char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.';
+        };
+
+        std::function<void(const std::string&, bool)> collectAliases = [&](const std::string& expression, bool in_alias) {
+            size_t begin = 0;
+            while (begin < expression.size()) {
+                if (! is_name(expression[begin])) {
+                    begin++;
+                    continue;
+                }
+
+                size_t end = begin;
+                while (end < expression.size() && is_name(expression[end]))
+                    end++;
+
+                std::string name = expression.substr(begin, end - begin);
+                begin = end;
+
+                const char* alias = m_chain.GetAlias(name.c_str());
+                if (alias) {
+                    if (aliases.insert(name).second)
+                        collectAliases(alias, true);
+                } else if (in_alias) {
+                    TLeaf* leaf = m_chain.FindLeaf(name.c_str());
+                    if (leaf)
+                        add(leaf);
+                }
+            }
+        };
+
+        auto collect = [&add, &collectAliases](const Expression& expression) {
+            if (! expression.formula)
+                return;
+
+            for (int i = 0; i < expression.formula->GetNcodes(); i++) {
+                TLeaf* leaf = expression.formula->GetLeaf(i);
+                if (leaf)
+                    add(leaf);
+            }
+
+            collectAliases(expression.string, false);
+        };
+
+        for (const auto& booking: m_bookings) {
+            collect(booking.draw);
+            collect(booking.draw_y);
+        }
+
+        for (const auto& selection: m_selections)
+            collect(selection.expression);
+
+        for (const auto& input: m_inputs)
+            branches.emplace(input.leaf->GetBranch()->GetName());
+
+        m_chain.SetBranchStatus("*", false);
+        for (const auto& branch: branches)
+            m_chain.SetBranchStatus(branch.c_str(), true);
+
+        m_chain.SetCacheSize(m_cache_size);
+
+        // With learn entries, the cache finds the branches actually read by itself. The number of
+        // learn entries is global to TTreeCache, and is set once by main()
+        if (m_cache_learn_entries <= 0) {
+            // Prime the cache with exactly the branches we read, instead of waiting for the learning phase
+            for (const auto& branch: branches)
+                m_chain.AddBranchToCache(branch.c_str(), true);
+            m_chain.StopCacheLearningPhase();
+        }
+    }
+
+    void TreeFiller::setCacheOptions(int64_t size, int learn_entries) {
+        m_cache_size = size;
+        m_cache_learn_entries = learn_entries;
+    }
+
+    void TreeFiller::collectStatistics() {
+        TFile* file = m_chain.GetCurrentFile();
+        if (! file)
+            return;
+
+        m_statistics.read_calls += file->GetReadCalls();
+        m_statistics.bytes_read += file->GetBytesRead();
+
+        TTreeCache* cache = dynamic_cast<TTreeCache*>(file->GetCacheRead(m_chain.GetTree()));
+        if (cache) {
+            m_statistics.cache_efficiency_sum += cache->GetEfficiency();
+            m_statistics.caches++;
+        }
+    }
+
+    int TreeFiller::ndata(Expression& expression, int64_t entry) {
+        if (expression.formula)
+            return expression.formula->GetNdata();
+
+        // Kernels only read scalar leaves: exactly one instance
+        for (size_t i = 0; i < expression.inputs.size(); i++) {
+            Input& input = m_inputs[expression.inputs[i]];
+            if (input.entry != entry) {
+                input.leaf->GetBranch()->GetEntry(entry);
+                input.value = input.leaf->GetValue(0);
+                input.entry = entry;
+            }
+
+            expression.values[i] = input.value;
+        }
+
+        return 1;
+    }
+
+    bool TreeFiller::multiple(const Expression& expression) const {
+        return expression.formula && expression.formula->GetMultiplicity();
+    }
+
+    double TreeFiller::eval(Expression& expression, int instance) {
+        if (expression.formula)
+            return expression.formula->EvalInstance(instance);
+
+        return expression.kernel->function(expression.values.data());
+    }
+
+    void TreeFiller::fillBooking(Booking& booking, double x, double y, double weight) {
+        if (booking.hist2d)
+            booking.hist2d->Fill(x, y, weight);
+        else
+            booking.hist->Fill(x, weight);
+    }
+
+    bool TreeFiller::fill(int64_t first/* = 0*/, int64_t last/* = -1*/) {
+
+        if (m_bookings.empty())
+            return true;
+
+        for (auto& selection: m_selections)
+            selection.selected.clear();
+
+        m_statistics = ReadStatistics();
+
+        // Formulas can only be compiled once a tree of the chain is loaded
+        if (m_chain.LoadTree(first) < 0)
+            return true;
+
+        {
+            std::lock_guard<std::mutex> lock(s_compile_mutex);
+
+            if (! compile()) {
+                clearFormulas();
+                return false;
+            }
+        }
+
+        activateBranches();
+
+        int tree_number = m_chain.GetTreeNumber();
+        Long64_t entries = (last < 0) ? m_chain.GetEntries() : last;
+
+        // No prefetching past the range: it is read by another filler, or not at all in preview mode
+        m_chain.SetCacheEntryRange(first, entries);
+
+        // Selections with an entry list are only evaluated on the entries of their list. If all the selections
+        // have one, only the union of the lists needs to be read
+        bool all_listed = true;
+        std::vector<int64_t> listed;
+        for (auto& selection: m_selections) {
+            if (! selection.entry_list) {
+                all_listed = false;
+                continue;
+            }
+
+            auto begin = std::lower_bound(selection.entry_list->begin(), selection.entry_list->end(), first);
+            auto end = std::lower_bound(begin, selection.entry_list->end(), entries);
+
+            selection.next_listed = begin - selection.entry_list->begin();
+            listed.insert(listed.end(), begin, end);
+        }
+
+        if (all_listed) {
+            std::sort(listed.begin(), listed.end());
+            listed.erase(std::unique(listed.begin(), listed.end()), listed.end());
+        }
+
+        size_t listed_index = 0;
+        for (Long64_t entry = first; entry < entries; entry++) {
+            if (all_listed) {
+                if (listed_index == listed.size())
+                    break;
+
+                entry = listed[listed_index++];
+            }
+
+            // The file of the current tree is closed when the chain moves to the next one
+            TTree* current_tree = m_chain.GetTree();
+            if (current_tree && entry >= m_chain.GetChainOffset() + current_tree->GetEntries())
+                collectStatistics();
+
+            Long64_t local_entry = m_chain.LoadTree(entry);
+            if (local_entry < 0)
+                break;
+
+            if (m_chain.GetTreeNumber() != tree_number) {
+                tree_number = m_chain.GetTreeNumber();
+                for (auto& booking: m_bookings) {
+                    if (booking.draw.formula)
+                        booking.draw.formula->UpdateFormulaLeaves();
+
+                    if (booking.draw_y.formula)
+                        booking.draw_y.formula->UpdateFormulaLeaves();
+                }
+
+                for (auto& selection: m_selections) {
+                    if (selection.expression.formula)
+                        selection.expression.formula->UpdateFormulaLeaves();
+                }
+
+                if (! updateInputs() || ! checkKernels()) {
+                    clearFormulas();
+                    return false;
+                }
+            }
+
+            double tree_weight = m_chain.GetWeight();
+
+            // Same logic as TSelectorDraw, so that the histograms are identical to
+            // the ones produced by TTree::Draw, including for array expressions
+            for (auto& selection: m_selections) {
+                double weight = tree_weight;
+                bool selection_multiple = false;
+                int selection_ndata = 1;
+
+                if (selection.entry_list) {
+                    const auto& entry_list = *selection.entry_list;
+                    while (selection.next_listed < entry_list.size() && entry_list[selection.next_listed] < entry)
+                        selection.next_listed++;
+
+                    if (selection.next_listed == entry_list.size() || entry_list[selection.next_listed] != entry)
+                        continue;
+                }
+
+                if (! selection.expression.string.empty()) {
+                    selection_ndata = ndata(selection.expression, local_entry);
+                    if (! selection_ndata)
+                        continue;
+
+                    selection_multiple = multiple(selection.expression);
+
+                    double value = eval(selection.expression, 0);
+                    bool selected = (value != 0);
+
+                    weight *= value;
+
+                    if (selection_multiple) {
+                        selection.weights.resize(selection_ndata);
+                        selection.weights[0] = weight;
+                        for (int i = 1; i < selection_ndata; i++) {
+                            value = eval(selection.expression, i);
+                            selected |= (value != 0);
+                            selection.weights[i] = tree_weight * value;
+                        }
+                    }
+
+                    if (selected && ! selection.entry_list)
+                        selection.selected.push_back(entry);
+
+                    if (! weight && ! selection_multiple)
+                        continue;
+                }
+
+                for (size_t index: selection.bookings) {
+                    auto& booking = m_bookings[index];
+
+                    int draw_ndata = ndata(booking.draw, local_entry);
+                    if (! draw_ndata)
+                        continue;
+
+                    bool x_multiple = multiple(booking.draw);
+                    bool y_multiple = false;
+
+                    if (booking.hist2d) {
+                        int y_ndata = ndata(booking.draw_y, local_entry);
+                        if (! y_ndata)
+                            continue;
+
+                        y_multiple = multiple(booking.draw_y);
+                        if (y_multiple)
+                            draw_ndata = x_multiple ? std::min(draw_ndata, y_ndata) : y_ndata;
+                    }
+
+                    bool draw_multiple = x_multiple || y_multiple;
+                    if (selection_multiple)
+                        draw_ndata = draw_multiple ? std::min(draw_ndata, selection_ndata) : selection_ndata;
+
+                    double x = eval(booking.draw, 0);
+                    double y = booking.hist2d ? eval(booking.draw_y, 0) : 0;
+                    if (weight)
+                        fillBooking(booking, x, y, weight);
+
+                    for (int i = 1; i < draw_ndata; i++) {
+                        double instance_weight = selection_multiple ? selection.weights[i] : weight;
+                        if (! instance_weight)
+                            continue;
+
+                        fillBooking(booking, x_multiple ? eval(booking.draw, i) : x, y_multiple ? eval(booking.draw_y, i) : y, instance_weight);
+                    }
+                }
+            }
+        }
+
+        collectStatistics();
+        clearFormulas();
+
+        return true;
+    }
+
+    std::vector<std::pair<int64_t, int64_t>> TreeFiller::clusters(TChain& chain) {
+        // List the clusters of all the trees of the chain, in global entry numbers
+        std::vector<std::pair<int64_t, int64_t>> clusters;
+        Long64_t offset = 0;
+        while (chain.LoadTree(offset) >= 0) {
+            TTree* tree = chain.GetTree();
+            Long64_t entries = tree->GetEntries();
+            if (! entries)
+                break;
+
+            auto cluster_iterator = tree->GetClusterIterator(0);
+            Long64_t start = 0;
+            while ((start = cluster_iterator()) < entries) {
+                clusters.emplace_back(offset + start, offset + std::min(cluster_iterator.GetNextEntry(), entries));
+            }
+
+            offset += entries;
+        }
+
+        return clusters;
+    }
+
+    std::vector<std::pair<int64_t, int64_t>> TreeFiller::split(TChain& chain, size_t n, int64_t last/* = -1*/) {
+        std::vector<std::pair<int64_t, int64_t>> ranges;
+
+        if (n <= 1) {
+            ranges.emplace_back(0, last);
+            return ranges;
+        }
+
+        auto clusters = TreeFiller::clusters(chain);
+        if (last >= 0) {
+            clusters.erase(std::remove_if(clusters.begin(), clusters.end(), [last](const std::pair<int64_t, int64_t>& cluster) {
+                        return cluster.first >= last;
+                    }), clusters.end());
+
+            if (! clusters.empty())
+                clusters.back().second = std::min(clusters.back().second, last);
+        }
+
+        if (clusters.empty())
+            return ranges;
+
+        // Group consecutive clusters until each range has its share of the entries
+        int64_t total = clusters.back().second;
+        int64_t target = (total + n - 1) / n;
+
+        int64_t range_start = clusters.front().first;
+        for (const auto& cluster: clusters) {
+            if (cluster.second - range_start >= target) {
+                ranges.emplace_back(range_start, cluster.second);
+                range_start = cluster.second;
+            }
+        }
+
+        if (range_start < total)
+            ranges.emplace_back(range_start, total);
+
+        return ranges;
+    }
+
+    int64_t TreeFiller::previewEnd(TChain& chain, double fraction) {
+        auto clusters = TreeFiller::clusters(chain);
+        if (clusters.empty())
+            return 0;
+
+        int64_t target = static_cast<int64_t>(std::ceil(fraction * clusters.back().second));
+        for (const auto& cluster: clusters) {
+            if (cluster.second >= target)
+                return cluster.second;
+        }
+
+        return clusters.back().second;
+    }
+
+    bool TreeFiller::splitDrawString(const std::string& draw_string, std::string& x, std::string& y) {
+        // Look for a ':' outside of parentheses, brackets and strings, and which is not part of a '::'
+        int depth = 0;
+        bool in_string = false;
+        size_t separator = std::string::npos;
+
+        for (size_t i = 0; i < draw_string.size(); i++) {
+            char c = draw_string[i];
+
+            if (c == '"')
+                in_string = !in_string;
+
+            if (in_string)
+                continue;
+
+            if (c == '(' || c == '[')
+                depth++;
+            else if (c == ')' || c == ']')
+                depth--;
+            else if (c == ':' && depth == 0) {
+                if (i + 1 < draw_string.size() && draw_string[i + 1] == ':') {
+                    i++;
+                    continue;
+                }
+
+                // More than two dimensions
+                if (separator != std::string::npos)
+                    return false;
+
+                separator = i;
+            }
+        }
+
+        if (separator == std::string::npos)
+            return false;
+
+        y = draw_string.substr(0, separator);
+        x = draw_string.substr(separator + 1);
+
+        return !x.empty() && !y.empty();
+    }
+}
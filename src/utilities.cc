@@ -5,10 +5,17 @@
 #include <yaml-cpp/yaml.h>
 
 #include <TH1.h>
+#include <TH2.h>
 #include <THStack.h>
 #include <TStyle.h>
 #include <TColor.h>
 
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+
 namespace plotIt {
 
   TStyle* createStyle(const Configuration& config) {
@@ -190,6 +197,14 @@ namespace plotIt {
 
       return 0;
   }
+
+  double integralAndError(const TH1* hist, double& error) {
+    const TH2* hist2d = dynamic_cast<const TH2*>(hist);
+    if (hist2d)
+      return hist2d->IntegralAndError(0, hist2d->GetNbinsX() + 1, 0, hist2d->GetNbinsY() + 1, error);
+
+    return hist->IntegralAndError(0, hist->GetNbinsX() + 1, error);
+  }
   
   void replace_substr(std::string &s, const std::string &old, const std::string &rep){
     size_t pos(0);
@@ -258,4 +273,73 @@ namespace plotIt {
 
       return result;
   }
+
+  std::string fingerprint(const std::string& data) {
+      uint64_t hash = 14695981039346656037ULL;
+      for (unsigned char c: data) {
+          hash ^= c;
+          hash *= 1099511628211ULL;
+      }
+
+      char buffer[17];
+      snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+
+      return buffer;
+  }
+
+  std::string fileIdentity(const std::string& path) {
+      boost::system::error_code error;
+
+      boost::filesystem::path file(path);
+      uintmax_t size = boost::filesystem::file_size(file, error);
+      if (error)
+          return "";
+
+      std::time_t mtime = boost::filesystem::last_write_time(file, error);
+      if (error)
+          return "";
+
+      std::string canonical = boost::filesystem::canonical(file, error).string();
+      if (error)
+          return "";
+
+      return canonical + '\n' + std::to_string(size) + '\n' + std::to_string(mtime);
+  }
+
+  std::string normalizeExpression(const std::string& expression) {
+      // Characters of identifiers and numbers, and of operators: two characters of the same kind
+      // separated by whitespaces would form a different token if joined
+      auto kind = [](char c) {
+          if (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '$')
+              return 1;
+
+          if (std::strchr("+-*/%<>=!&|^~?:", c))
+              return 2;
+
+          return 0;
+      };
+
+      std::string result;
+      bool in_string = false;
+      bool space = false;
+
+      for (char c: expression) {
+          if (!in_string && std::isspace(static_cast<unsigned char>(c))) {
+              space = true;
+              continue;
+          }
+
+          if (space && !result.empty() && kind(c) != 0 && kind(c) == kind(result.back()))
+              result += ' ';
+
+          space = false;
+
+          if (c == '"')
+              in_string = !in_string;
+
+          result += c;
+      }
+
+      return result;
+  }
 }
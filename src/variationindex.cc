@@ -0,0 +1,39 @@
+#include <inputfilepool.h>
+#include <variationindex.h>
+
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace plotIt {
+
+    VariationIndex::VariationIndex(const std::string& path) {
+        fs::path nominal(path);
+        fs::path directory = nominal.parent_path();
+
+        std::string prefix = nominal.stem().string() + "__";
+
+        // The listing is sorted: the friend files are the names starting with the prefix
+        std::shared_ptr<const std::vector<std::string>> names = InputFilePool::get().listing(directory.native());
+        for (auto it = std::lower_bound(names->begin(), names->end(), prefix);
+                it != names->end() && it->compare(0, prefix.size(), prefix) == 0; ++it) {
+            fs::path filename(*it);
+            std::string stem = filename.stem().string();
+
+            // Same path as the one built from the nominal path, used as key by the pool of files
+            m_friends.emplace(stem.substr(prefix.size() - 2), (directory / filename).native());
+        }
+    }
+
+    const std::string& VariationIndex::friendFile(const std::string& postfix) const {
+        static const std::string none;
+
+        auto it = m_friends.find(postfix);
+        if (it == m_friends.end())
+            return none;
+
+        return it->second;
+    }
+}
@@ -0,0 +1,742 @@
+/**
+ * Unit tests of the internals of plotIt, run by tests.py.
+ *
+ * Each test compares a component with a straightforward reference implementation.
+ * Temporary files are written in $TMPDIR.
+ *
+ * Usage: plotIt-tests [test...]. Without argument, all the tests are run.
+ **/
+
+#include <globmatcher.h>
+#include <histogramstore.h>
+#include <kernels.h>
+#include <systematics.h>
+#include <treefiller.h>
+#include <types.h>
+
+#include <TChain.h>
+#include <TFile.h>
+#include <TH1.h>
+#include <TH2.h>
+#include <TProfile.h>
+#include <TTree.h>
+
+#include <fnmatch.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace plotIt;
+
+namespace {
+
+    size_t s_failures = 0;
+
+    bool check(bool condition, const char* expression, const char* file, int line) {
+        if (! condition) {
+            std::cout << "  " << file << ":" << line << ": check failed: " << expression << std::endl;
+            s_failures++;
+        }
+
+        return condition;
+    }
+
+    #define CHECK(condition) check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+    bool close(double a, double b, double tolerance = 1e-9) {
+        return std::abs(a - b) <= tolerance * std::max({1., std::abs(a), std::abs(b)});
+    }
+
+    bool sameContents(const TH1& a, const TH1& b, double tolerance = 1e-9) {
+        if (a.GetNcells() != b.GetNcells())
+            return false;
+
+        for (int i = 0; i < a.GetNcells(); i++) {
+            if (! close(a.GetBinContent(i), b.GetBinContent(i), tolerance))
+                return false;
+        }
+
+        return true;
+    }
+
+    std::string temporaryPath(const std::string& name) {
+        const char* directory = std::getenv("TMPDIR");
+
+        return std::string(directory ? directory : "/tmp") + "/plotIt-tests-" + name;
+    }
+
+    /**
+     * All the plots booked on a tree must be filled by a single call to TreeFiller::fill,
+     * like a separate loop over the tree for each of them would.
+     **/
+    void testTreeFiller() {
+        std::string path = temporaryPath("tree.root");
+
+        struct Event {
+            float x;
+            int n;
+        };
+
+        std::vector<Event> events;
+        std::mt19937 generator(42);
+        std::normal_distribution<float> gaus(5, 2);
+        for (int i = 0; i < 10000; i++)
+            events.push_back({gaus(generator), i % 7});
+
+        {
+            std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "recreate"));
+            TTree tree("t", "");
+
+            Event event;
+            tree.Branch("x", &event.x, "x/F");
+            tree.Branch("n", &event.n, "n/I");
+            for (const Event& e: events) {
+                event = e;
+                tree.Fill();
+            }
+
+            file->Write();
+        }
+
+        // Draw string, selection string, and the same computed by hand
+        struct Case {
+            std::string draw;
+            std::string selection;
+            std::function<std::pair<double, bool>(const Event&)> reference;
+        };
+
+        std::vector<Case> cases = {
+            {"x", "", [](const Event& e) { return std::make_pair<double, bool>(e.x, true); }},
+            {"x", "n > 2", [](const Event& e) { return std::make_pair<double, bool>(e.x, e.n > 2); }},
+            {"2 * x - n", "n == 3 || x > 6", [](const Event& e) { return std::make_pair<double, bool>(2. * e.x - e.n, e.n == 3 || e.x > 6); }},
+        };
+
+        TChain chain("t");
+        chain.Add(path.c_str());
+
+        TreeFiller filler(chain);
+
+        std::vector<Plot> plots(cases.size());
+        std::vector<std::shared_ptr<TH1>> histograms;
+        for (size_t i = 0; i < cases.size(); i++) {
+            plots[i].name = "plot" + std::to_string(i);
+            plots[i].binning_x = 50;
+            plots[i].x_axis_range = {-5, 20};
+            plots[i].draw_string = cases[i].draw;
+            plots[i].selection_string = cases[i].selection;
+
+            histograms.push_back(filler.book(plots[i], plots[i].name));
+        }
+
+        CHECK(filler.selections() == 3);
+        CHECK(filler.fill());
+
+        for (size_t i = 0; i < cases.size(); i++) {
+            TH1D reference("reference", "", 50, -5, 20);
+            for (const Event& e: events) {
+                auto value = cases[i].reference(e);
+                if (value.second)
+                    reference.Fill(value.first);
+            }
+
+            CHECK(sameContents(*histograms[i], reference, 1e-6));
+        }
+
+        std::remove(path.c_str());
+    }
+
+    /**
+     * Plots whose selections only differ by their whitespaces share a single selection, evaluated
+     * once per entry, and get the same contents
+     **/
+    void testSharedSelection() {
+        std::string path = temporaryPath("shared_selection.root");
+
+        std::vector<float> events;
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> uniform(0, 10);
+        for (int i = 0; i < 10000; i++)
+            events.push_back(uniform(generator));
+
+        {
+            std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "recreate"));
+            TTree tree("t", "");
+
+            float x;
+            tree.Branch("x", &x, "x/F");
+            for (float event: events) {
+                x = event;
+                tree.Fill();
+            }
+
+            file->Write();
+        }
+
+        TChain chain("t");
+        chain.Add(path.c_str());
+
+        TreeFiller filler(chain);
+
+        std::vector<std::shared_ptr<TH1>> histograms;
+        for (const char* selection: {"x > 3 && x < 8", " x>3&&x<8 ", "x  >  3  &&  x  <  8"}) {
+            Plot plot;
+            plot.name = "plot" + std::to_string(histograms.size());
+            plot.binning_x = 50;
+            plot.x_axis_range = {0, 10};
+            plot.draw_string = "x";
+            plot.selection_string = selection;
+
+            histograms.push_back(filler.book(plot, plot.name));
+        }
+
+        CHECK(filler.selections() == 1);
+        CHECK(filler.fill());
+
+        CHECK(sameContents(*histograms[0], *histograms[1]));
+        CHECK(sameContents(*histograms[0], *histograms[2]));
+
+        // Each selected entry is recorded once, by the single evaluation of the selection
+        std::vector<int64_t> selected;
+        for (size_t i = 0; i < events.size(); i++) {
+            if (events[i] > 3 && events[i] < 8)
+                selected.push_back(i);
+        }
+
+        CHECK(filler.selectedEntries(0) == selected);
+
+        std::remove(path.c_str());
+    }
+
+    /**
+     * Only the branches read by the formulas are enabled. The branches read through an alias,
+     * or from a friend tree, must be enabled too.
+     **/
+    void testTreeFillerAliases() {
+        std::string path = temporaryPath("aliases.root");
+
+        struct Event {
+            float x;
+            float y;
+            float z;
+        };
+
+        std::vector<Event> events;
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> uniform(0, 10);
+        for (int i = 0; i < 10000; i++)
+            events.push_back({uniform(generator), uniform(generator), uniform(generator)});
+
+        {
+            std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "recreate"));
+            TTree tree("t", "");
+            TTree friend_tree("f", "");
+
+            Event event;
+            tree.Branch("x", &event.x, "x/F");
+            tree.Branch("y", &event.y, "y/F");
+            friend_tree.Branch("z", &event.z, "z/F");
+            for (const Event& e: events) {
+                event = e;
+                tree.Fill();
+                friend_tree.Fill();
+            }
+
+            // An alias of an alias, stored with the tree
+            tree.SetAlias("sum", "x + y");
+            tree.SetAlias("twice_sum", "2 * sum");
+
+            file->Write();
+        }
+
+        struct Case {
+            std::string draw;
+            std::string selection;
+            std::function<std::pair<double, bool>(const Event&)> reference;
+        };
+
+        std::vector<Case> cases = {
+            {"sum", "", [](const Event& e) { return std::make_pair<double, bool>(static_cast<double>(e.x) + e.y, true); }},
+            {"twice_sum", "y > 5", [](const Event& e) { return std::make_pair<double, bool>(2. * (static_cast<double>(e.x) + e.y), e.y > 5); }},
+            {"x", "f.z > 5", [](const Event& e) { return std::make_pair<double, bool>(e.x, e.z > 5); }},
+        };
+
+        TChain chain("t");
+        chain.Add(path.c_str());
+        chain.AddFriend("f", path.c_str());
+
+        TreeFiller filler(chain);
+
+        std::vector<std::shared_ptr<TH1>> histograms;
+        for (const Case& c: cases) {
+            Plot plot;
+            plot.name = "plot" + std::to_string(histograms.size());
+            plot.binning_x = 50;
+            plot.x_axis_range = {0, 40};
+            plot.draw_string = c.draw;
+            plot.selection_string = c.selection;
+
+            histograms.push_back(filler.book(plot, plot.name));
+        }
+
+        CHECK(filler.fill());
+
+        for (size_t i = 0; i < cases.size(); i++) {
+            TH1D reference("reference", "", 50, 0, 40);
+            for (const Event& e: events) {
+                auto value = cases[i].reference(e);
+                if (value.second)
+                    reference.Fill(value.first);
+            }
+
+            if (! CHECK(sameContents(*histograms[i], reference, 1e-6)))
+                std::cout << "    draw string: " << cases[i].draw << ", selection: " << cases[i].selection << std::endl;
+        }
+
+        std::remove(path.c_str());
+    }
+
+    /**
+     * 2D draw strings are split like TTree::Draw does, on the ':' outside of parentheses,
+     * brackets and strings, and which is not part of a '::'
+     **/
+    void testSplitDrawString() {
+        struct Case {
+            std::string draw;
+            bool valid;
+            std::string x;
+            std::string y;
+        };
+
+        const std::vector<Case> cases = {
+            {"y:x", true, "x", "y"},
+            {"sqrt(a*a + b*b):TMath::Abs(c)", true, "TMath::Abs(c)", "sqrt(a*a + b*b)"},
+            {"jets[0].pt:Max$(jets.eta[1])", true, "Max$(jets.eta[1])", "jets[0].pt"},
+            {"(a > 0 ? a : b):c", true, "c", "(a > 0 ? a : b)"},
+            {"name == \"a:b\":c", true, "c", "name == \"a:b\""},
+            {"x", false, "", ""},
+            {"TMath::Abs(x)", false, "", ""},
+            {"z:y:x", false, "", ""},
+            {":x", false, "", ""},
+            {"y:", false, "", ""},
+        };
+
+        for (const Case& c: cases) {
+            std::string x, y;
+            bool valid = TreeFiller::splitDrawString(c.draw, x, y);
+
+            if (! CHECK(valid == c.valid))
+                std::cout << "    draw string: " << c.draw << std::endl;
+
+            if (valid && c.valid && ! CHECK(x == c.x && y == c.y))
+                std::cout << "    draw string: " << c.draw << ", x: '" << x << "', y: '" << y << "'" << std::endl;
+        }
+    }
+
+    /**
+     * Plots with a binning along y are filled as TH2, from their 'y:x' draw string
+     **/
+    void testTreeFiller2D() {
+        std::string path = temporaryPath("tree2d.root");
+
+        std::vector<std::pair<float, float>> events;
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> uniform(0, 10);
+        for (int i = 0; i < 10000; i++)
+            events.emplace_back(uniform(generator), uniform(generator));
+
+        {
+            std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "recreate"));
+            TTree tree("t", "");
+
+            float x, y;
+            tree.Branch("x", &x, "x/F");
+            tree.Branch("y", &y, "y/F");
+            for (const auto& event: events) {
+                x = event.first;
+                y = event.second;
+                tree.Fill();
+            }
+
+            file->Write();
+        }
+
+        TChain chain("t");
+        chain.Add(path.c_str());
+
+        TreeFiller filler(chain);
+
+        Plot plot;
+        plot.name = "plot2d";
+        plot.binning_x = 20;
+        plot.binning_y = 10;
+        plot.x_axis_range = {0, 10};
+        plot.y_axis_range = {0, 5};
+        plot.draw_string = "y:x";
+        plot.selection_string = "x + y < 12";
+
+        std::shared_ptr<TH1> hist = filler.book(plot, plot.name);
+        CHECK(hist->GetDimension() == 2);
+        CHECK(filler.fill());
+
+        TH2D reference("reference", "", 20, 0, 10, 10, 0, 5);
+        for (const auto& event: events) {
+            if (static_cast<double>(event.first) + event.second < 12)
+                reference.Fill(event.first, event.second);
+        }
+
+        CHECK(sameContents(*hist, reference, 1e-6));
+
+        std::remove(path.c_str());
+    }
+
+    /**
+     * GlobMatcher must give the same matches as testing each pattern with fnmatch, like the
+     * expansion of the plots did before
+     **/
+    void testGlobMatcher() {
+        std::mt19937 generator(42);
+        auto random = [&generator](size_t n) {
+            return std::uniform_int_distribution<size_t>(0, n - 1)(generator);
+        };
+
+        auto randomName = [&random]() {
+            static const std::string letters = "aAbB_1.";
+
+            std::string name;
+            for (size_t i = random(8); i > 0; i--)
+                name += letters[random(letters.size())];
+
+            return name;
+        };
+
+        auto randomPattern = [&random]() {
+            static const std::vector<std::string> tokens = {"a", "A", "b", "B", "_", "1", ".", "*", "?", "[ab]", "[!a]", "[A-B]", "\\*", "\\a"};
+
+            std::string pattern;
+            for (size_t i = random(6); i > 0; i--)
+                pattern += tokens[random(tokens.size())];
+
+            return pattern;
+        };
+
+        GlobMatcher matcher;
+        std::vector<std::pair<std::string, std::string>> patterns;
+        for (size_t i = 0; i < 300; i++) {
+            std::string pattern = randomPattern();
+            std::string exclude = random(3) ? "" : randomPattern();
+
+            patterns.emplace_back(pattern, exclude);
+            CHECK(matcher.add(pattern, exclude) == i);
+        }
+
+        CHECK(matcher.size() == patterns.size());
+
+        std::vector<size_t> matches;
+        for (size_t i = 0; i < 3000; i++) {
+            std::string name = randomName();
+
+            std::vector<size_t> expected;
+            for (size_t p = 0; p < patterns.size(); p++) {
+                if (fnmatch(patterns[p].first.c_str(), name.c_str(), FNM_CASEFOLD) != 0)
+                    continue;
+
+                if (! patterns[p].second.empty() && fnmatch(patterns[p].second.c_str(), name.c_str(), FNM_CASEFOLD) == 0)
+                    continue;
+
+                expected.push_back(p);
+            }
+
+            matcher.match(name, matches);
+            if (! CHECK(matches == expected)) {
+                std::cout << "    name: " << name << std::endl;
+                break;
+            }
+        }
+    }
+
+    bool sameAxis(const TAxis& a, const TAxis& b) {
+        if (a.GetNbins() != b.GetNbins())
+            return false;
+
+        for (int i = 1; i <= a.GetNbins() + 1; i++) {
+            if (a.GetBinLowEdge(i) != b.GetBinLowEdge(i))
+                return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Histograms read from a store must be identical to the ones of the input file, including their
+     * class, and the store must list all the keys of the input file, packed or not
+     **/
+    void testHistogramStore() {
+        std::string input = temporaryPath("store-input.root");
+        std::string store = temporaryPath("store.pack");
+
+        TH1F fixed("fixed", "Fixed binning", 50, -3, 3);
+
+        const double edges[] = {-3, -1, -0.5, 0, 0.2, 1, 3};
+        TH1D variable("variable", "Variable binning", 6, edges);
+        variable.Sumw2();
+
+        // Not packed
+        TProfile profile("profile", "", 10, -3, 3);
+        TH2F hist2d("hist2d", "", 10, -3, 3, 10, -3, 3);
+        TH1F labels("labels", "", 2, 0, 2);
+        labels.GetXaxis()->SetBinLabel(1, "a");
+        labels.GetXaxis()->SetBinLabel(2, "b");
+
+        std::mt19937 generator(42);
+        std::normal_distribution<double> gaus(0, 1.5);
+        for (int i = 0; i < 5000; i++) {
+            double x = gaus(generator);
+            double y = gaus(generator);
+
+            fixed.Fill(x);
+            variable.Fill(x, 0.5 + std::abs(y));
+            profile.Fill(x, y);
+            hist2d.Fill(x, y);
+            labels.Fill(x > 0 ? "a" : "b", 1);
+        }
+
+        {
+            std::unique_ptr<TFile> file(TFile::Open(input.c_str(), "recreate"));
+            for (TH1* hist: std::vector<TH1*>{&fixed, &variable, &profile, &hist2d, &labels})
+                file->WriteTObject(hist);
+
+            file->mkdir("directory")->WriteTObject(&variable, "nested");
+        }
+
+        CHECK(HistogramStore::pack(input, store) == 3);
+
+        std::shared_ptr<HistogramStore> packed = HistogramStore::open(store);
+        if (! CHECK(packed))
+            return;
+
+        // Indexed by name and by name;cycle
+        CHECK(packed->size() == 3 * 2);
+        CHECK(packed->entries().size() == 6);
+
+        for (const char* name: {"profile", "hist2d", "labels"})
+            CHECK(! packed->contains(name) && packed->listed(name) && ! packed->read(name));
+
+        CHECK(packed->listed("fixed;1") && packed->contains("fixed;1"));
+        CHECK(! packed->listed("missing") && ! packed->read("missing"));
+
+        const std::vector<std::pair<std::string, const TH1*>> histograms = {
+            {"fixed", &fixed}, {"variable", &variable}, {"directory/nested", &variable}
+        };
+
+        for (const auto& h: histograms) {
+            std::shared_ptr<TH1> hist = packed->read(h.first);
+            if (! CHECK(hist)) {
+                std::cout << "    histogram: " << h.first << std::endl;
+                continue;
+            }
+
+            CHECK(hist->IsA() == h.second->IsA());
+            CHECK(std::string(hist->GetTitle()) == h.second->GetTitle());
+            CHECK(sameAxis(*hist->GetXaxis(), *h.second->GetXaxis()));
+            CHECK(hist->GetEntries() == h.second->GetEntries());
+
+            bool same = true;
+            for (int i = 0; i < hist->GetNcells(); i++)
+                same = same && hist->GetBinContent(i) == h.second->GetBinContent(i) && hist->GetBinError(i) == h.second->GetBinError(i);
+
+            if (! CHECK(same))
+                std::cout << "    histogram: " << h.first << std::endl;
+        }
+
+        packed.reset();
+        std::remove(store.c_str());
+        std::remove(input.c_str());
+    }
+
+    std::vector<double> contents(const TH1& hist) {
+        std::vector<double> result(hist.GetNcells());
+        for (size_t i = 0; i < result.size(); i++)
+            result[i] = hist.GetBinContent(i);
+
+        return result;
+    }
+
+    bool sameContents(const std::vector<double>& shape, const TH1& hist) {
+        std::vector<double> expected = contents(hist);
+        if (shape.size() != expected.size())
+            return false;
+
+        for (size_t i = 0; i < shape.size(); i++) {
+            if (! close(shape[i], expected[i]))
+                return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * The shapes of a SystematicSet must follow the transformations applied by TH1Plotter on the
+     * nominal histogram: TH1::Scale, TH1::Rebin, and the folding of the bins outside of the range
+     **/
+    void testSystematicSet() {
+        const int bins = 23;
+
+        TH1D nominal("nominal", "", bins, 0, bins);
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<double> uniform(-3, bins + 3);
+        for (int i = 0; i < 5000; i++)
+            nominal.Fill(uniform(generator));
+
+        ConstantSystematic systematic(YAML::Node(1.2));
+
+        File file;
+        Plot plot;
+        SystematicSet set = systematic.newSet(std::make_shared<NominalShape>(nominal), file, plot);
+
+        // The shapes only depend on the snapshot of the nominal histogram
+        nominal.Scale(3);
+        set.update();
+        nominal.Scale(1. / 3);
+
+        CHECK(sameContents(set.nominal_shape, nominal));
+
+        for (int factor: {1, 2, 4, 5}) {
+            TH1D reference_nominal(nominal);
+            TH1D reference_up(nominal);
+            TH1D reference_down(nominal);
+            reference_up.Scale(systematic.value);
+            reference_down.Scale(2 - systematic.value);
+
+            SystematicSet s = set;
+            s.scale(0.5);
+            s.rebin(factor);
+
+            for (TH1* h: std::vector<TH1*>{&reference_nominal, &reference_up, &reference_down}) {
+                h->Scale(0.5);
+                h->Rebin(factor);
+            }
+
+            if (! CHECK(sameContents(s.nominal_shape, reference_nominal) && sameContents(s.up_shape, reference_up) &&
+                        sameContents(s.down_shape, reference_down)))
+                std::cout << "    rebin: " << factor << std::endl;
+
+            // Range of the plot inside of the histogram, like TH1Plotter::addOverflow
+            size_t first_bin = 2;
+            size_t last_bin = reference_nominal.GetNbinsX() - 1;
+            s.addOverflow(first_bin, last_bin);
+
+            for (TH1* h: std::vector<TH1*>{&reference_nominal, &reference_up, &reference_down}) {
+                double underflow = 0;
+                for (size_t i = 0; i < first_bin; i++) {
+                    underflow += h->GetBinContent(i);
+                    h->SetBinContent(i, 0);
+                }
+
+                double overflow = 0;
+                for (size_t i = last_bin + 1; i <= (size_t) h->GetNbinsX() + 1; i++) {
+                    overflow += h->GetBinContent(i);
+                    h->SetBinContent(i, 0);
+                }
+
+                h->SetBinContent(first_bin, h->GetBinContent(first_bin) + underflow);
+                h->SetBinContent(last_bin, h->GetBinContent(last_bin) + overflow);
+            }
+
+            if (! CHECK(sameContents(s.nominal_shape, reference_nominal) && sameContents(s.up_shape, reference_up) &&
+                        sameContents(s.down_shape, reference_down)))
+                std::cout << "    rebin: " << factor << ", overflow" << std::endl;
+        }
+    }
+
+    /**
+     * The kernels must give the results of plain loops, up to the reordering of the sums
+     **/
+    void testKernels() {
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<double> uniform(0, 100);
+
+        for (size_t n: {0, 1, 3, 8, 17, 1000}) {
+            std::vector<double> nominal(n), up(n), down(n), sum(n), a(n), b(n);
+            for (size_t i = 0; i < n; i++) {
+                nominal[i] = uniform(generator);
+                up[i] = uniform(generator);
+                down[i] = uniform(generator);
+                sum[i] = uniform(generator);
+                a[i] = uniform(generator) - 50;
+                b[i] = uniform(generator) - 50;
+            }
+
+            std::vector<double> reference_envelope(n);
+            double reference_total = 0;
+            for (size_t i = 0; i < n; i++) {
+                reference_envelope[i] = std::max(std::abs(up[i] - nominal[i]), std::abs(nominal[i] - down[i]));
+                reference_total += reference_envelope[i];
+            }
+
+            CHECK(close(kernels::envelope(nominal.data(), up.data(), down.data(), n), reference_total, 1e-12));
+
+            std::vector<double> envelope_sum = sum;
+            CHECK(close(kernels::addEnvelope(nominal.data(), up.data(), down.data(), envelope_sum.data(), n), reference_total, 1e-12));
+
+            std::vector<double> squares_sum = sum;
+            kernels::addSquares(a.data(), squares_sum.data(), n);
+
+            std::vector<double> roots = sum;
+            kernels::squareRoot(roots.data(), n);
+
+            std::vector<double> quadrature(n);
+            kernels::quadrature(a.data(), b.data(), quadrature.data(), n);
+
+            bool same = true;
+            for (size_t i = 0; i < n; i++) {
+                same = same && close(envelope_sum[i], sum[i] + reference_envelope[i]);
+                same = same && close(squares_sum[i], sum[i] + a[i] * a[i]);
+                same = same && close(roots[i], std::sqrt(sum[i]));
+                same = same && close(quadrature[i], std::sqrt(a[i] * a[i] + b[i] * b[i]));
+            }
+
+            if (! CHECK(same))
+                std::cout << "    size: " << n << std::endl;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+
+    TH1::AddDirectory(false);
+
+    const std::vector<std::pair<std::string, std::function<void()>>> tests = {
+        {"tree-filler", testTreeFiller},
+        {"shared-selection", testSharedSelection},
+        {"tree-filler-aliases", testTreeFillerAliases},
+        {"split-draw-string", testSplitDrawString},
+        {"tree-filler-2d", testTreeFiller2D},
+        {"glob-matcher", testGlobMatcher},
+        {"histogram-store", testHistogramStore},
+        {"systematic-set", testSystematicSet},
+        {"kernels", testKernels},
+    };
+
+    std::vector<std::string> selected(argv + 1, argv + argc);
+
+    for (const auto& test: tests) {
+        if (! selected.empty() && std::find(selected.begin(), selected.end(), test.first) == selected.end())
+            continue;
+
+        size_t failures = s_failures;
+        test.second();
+
+        std::cout << test.first << ": " << ((s_failures == failures) ? "ok" : "FAILED") << std::endl;
+    }
+
+    return s_failures ? 1 : 0;
+}
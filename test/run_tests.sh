@@ -1,6 +1,7 @@
 #! /bin/bash
 
 root -l -b -q generate_files.C &> /dev/null
+root -l -b -q generate_trees.C &> /dev/null
 
 [[ -d tmp ]] || mkdir tmp
 export TMPDIR=$(pwd)/tmp
@@ -66,3 +66,32 @@ def get_configuration():
 
     return configuration
 
+def get_tree_configuration(mode='tree'):
+    """
+    Configuration for the files of generate_trees.C, in tree or histogram mode. Both give the same plots.
+    """
+    configuration = get_configuration()
+
+    configuration['configuration']['root'] = 'files/trees'
+    configuration['plots']['histo1']['x-axis-range'] = [0, 10]
+
+    if mode == 'tree':
+        configuration['configuration']['mode'] = 'tree'
+        configuration['configuration']['tree-name'] = 't'
+        configuration['plots']['histo1']['draw-string'] = 'value'
+        configuration['plots']['histo1']['binning-x'] = 200
+
+    return configuration
+
+def get_shape_systematics_configuration(root='files'):
+    """
+    Configuration with the shape systematics 'alpha' and 'beta' of generate_files.C. Their variations
+    are stored next to the nominal histograms in 'files', and in separate files in 'files/friends'
+    """
+    configuration = get_configuration()
+
+    configuration['configuration']['root'] = root
+    configuration['configuration']['luminosity-error'] = 0.
+    configuration['systematics'] = ['alpha', 'beta']
+
+    return configuration
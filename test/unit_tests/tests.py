@@ -8,7 +8,7 @@ import yaml
 import tempfile
 import subprocess
 
-from configuration import get_configuration
+from configuration import get_configuration, get_tree_configuration, get_shape_systematics_configuration
 
 class TemporaryFolder:
     def __init__(self):
@@ -20,6 +20,63 @@ class TemporaryFolder:
 def get_golden_file(f):
     return os.path.join('golden', f)
 
+def copy_input_files(folder):
+    """
+    Copy the input files of `folder` into a temporary folder, for the tests modifying them
+    """
+    copy = TemporaryFolder()
+    for f in os.listdir(folder):
+        if f.endswith('.root'):
+            shutil.copy2(os.path.join(folder, f), copy.name)
+
+    return copy
+
+def touch(path):
+    """
+    Change the modification time of `path`, by more than the resolution of the file systems
+    """
+    mtime = os.path.getmtime(path) + 10
+    os.utime(path, (mtime, mtime))
+
+def list_files(folder, extension):
+    """
+    Files of `folder` with the extension `extension`, with their inode and modification time,
+    which change when a file is written again
+    """
+    files = {}
+    for f in os.listdir(folder):
+        if f.endswith(extension):
+            stat = os.stat(os.path.join(folder, f))
+            files[f] = (stat.st_ino, stat.st_mtime)
+
+    return files
+
+read_file_regexp = re.compile("File '(.*)': \\d+ read calls")
+def get_read_files(output):
+    """
+    Names of the files read in tree mode, from the output of plotIt -v
+    """
+    return sorted(os.path.basename(f) for f in read_file_regexp.findall(output))
+
+read_bytes_regexp = re.compile("File '(.*)': \\d+ read calls, ([0-9.e+-]+) MB read")
+def get_read_bytes(output):
+    """
+    MB read from each file in tree mode, from the output of plotIt -v
+    """
+    return dict((os.path.basename(f), float(mb)) for f, mb in read_bytes_regexp.findall(output))
+
+yield_regexp = re.compile('\$([0-9.]+)')
+def get_yields(folder, category):
+    """
+    Yields of `category` in the table of plotIt -y, in the order of the columns
+    """
+    with open(os.path.join(folder, 'yields.tex')) as f:
+        for line in f:
+            if line.strip().startswith(category + ' &'):
+                return [float(y) for y in yield_regexp.findall(line)]
+
+    return []
+
 convert_line_regexp = re.compile('(\d+):\s+\(\s*(\d+),\s*(\d+),\s*(\d+),\s*(\d+)\)')
 def get_images_likelihood(image1, image2):
     import subprocess
@@ -125,12 +182,32 @@ class plotItSimpleTestCase(unittest.TestCase):
         # Switch to True to generate golden images
         self.__generate_golden_images = False
 
-    def run_plotit(self, configuration):
+    def run_plotit(self, configuration, args=[]):
+        """
+        Run plotIt, and return its output
+        """
         with tempfile.NamedTemporaryFile() as yml:
             yml.write(yaml.dump(configuration, encoding='utf-8'))
             yml.flush()
-            with open(os.devnull, 'w+b') as null:
-                subprocess.check_call(['../plotIt', yml.name, '-o', self.output_folder.name], stdout=null)
+            return subprocess.check_output(['../plotIt', yml.name, '-o', self.output_folder.name] + args, universal_newlines=True)
+
+    def run_internal_test(self, name):
+        """
+        Run one of the tests of plotIt-tests, see internals.cc
+        """
+        output = subprocess.Popen(['../plotIt-tests', name], stdout=subprocess.PIPE, universal_newlines=True)
+        stdout = output.communicate()[0]
+
+        self.assertEqual(output.returncode, 0, stdout)
+
+    def keep_output(self, name, copy):
+        """
+        Copy the plot `name` of the last run, so that it is not overwritten by the next one
+        """
+        copy = os.path.join(self.output_folder.name, copy)
+        shutil.copyfile(os.path.join(self.output_folder.name, name), copy)
+
+        return copy
 
     def setUp(self):
         self.output_folder = TemporaryFolder()
@@ -351,6 +428,94 @@ class plotItTestCase(plotItSimpleTestCase):
                 get_golden_file('default_configuration_syst_not_found.pdf')
                 )
 
+    def test_max_open_files(self):
+        # The input files, and the files of the variations, are reopened when needed
+        for root in ['files', 'files/friends']:
+            self.run_plotit(get_shape_systematics_configuration(root), ['--max-open-files', '1'])
+
+            self.compare_images(
+                    os.path.join(self.output_folder.name, 'histo1.pdf'),
+                    get_golden_file('default_configuration_two_systs_shape.pdf')
+                    )
+
+    def test_file_order(self):
+        # The objects of all the plots, and of their variations, are read in the order of the files
+        configuration = get_shape_systematics_configuration()
+        configuration['plots']['histo2'] = dict(configuration['plots']['histo1'], **{'x-axis-range': [-3, 3], 'blinded-range': [-1, 1]})
+
+        for threads in ['1', '2']:
+            self.run_plotit(configuration, ['-j', threads])
+
+            self.assertTrue(os.path.exists(os.path.join(self.output_folder.name, 'histo2.pdf')))
+            self.compare_images(
+                    os.path.join(self.output_folder.name, 'histo1.pdf'),
+                    get_golden_file('default_configuration_two_systs_shape.pdf')
+                    )
+
+    def test_systematics_on(self):
+        # Systematics applying to all the MC files, or to none of them
+        configuration = get_shape_systematics_configuration()
+        configuration['systematics'] = [{name: {'type': 'shape', 'on': 'MC_sample'}} for name in ['alpha', 'beta']]
+
+        self.run_plotit(configuration)
+
+        self.compare_images(
+                os.path.join(self.output_folder.name, 'histo1.pdf'),
+                get_golden_file('default_configuration_two_systs_shape.pdf')
+                )
+
+        configuration['systematics'] = [{name: {'type': 'shape', 'on': 'i-do-not-match'}} for name in ['alpha', 'beta']]
+
+        self.run_plotit(configuration)
+
+        self.compare_images(
+                os.path.join(self.output_folder.name, 'histo1.pdf'),
+                get_golden_file('default_configuration_syst_not_found.pdf')
+                )
+
+    def test_systematics_show_errors(self):
+        configuration = get_shape_systematics_configuration()
+        yields = os.path.join(self.output_folder.name, 'yields.tex')
+
+        configuration['plots']['histo1']['show-errors'] = True
+        self.run_plotit(configuration, ['-y'])
+
+        self.compare_images(
+                os.path.join(self.output_folder.name, 'histo1.pdf'),
+                get_golden_file('default_configuration_two_systs_shape.pdf')
+                )
+
+        with open(yields) as f:
+            yields_with_errors = f.read()
+
+        # Without errors, the plot does not show the systematics, but the yields still include them
+        configuration['plots']['histo1']['show-errors'] = False
+        self.run_plotit(configuration, ['-y'])
+        reference = self.keep_output('histo1.pdf', 'histo1_without_errors.pdf')
+
+        with open(yields) as f:
+            self.assertEqual(f.read(), yields_with_errors)
+
+        configuration['systematics'] = []
+        self.run_plotit(configuration)
+        self.compare_images(os.path.join(self.output_folder.name, 'histo1.pdf'), reference)
+
+    def test_systematics_friend_files(self):
+        # Variations in the same files as the nominal histograms, or in their own files in the same directory
+        yields = {}
+        for root in ['files', 'files/friends']:
+            self.run_plotit(get_shape_systematics_configuration(root), ['-y'])
+
+            self.compare_images(
+                    os.path.join(self.output_folder.name, 'histo1.pdf'),
+                    get_golden_file('default_configuration_two_systs_shape.pdf')
+                    )
+
+            with open(os.path.join(self.output_folder.name, 'yields.tex')) as f:
+                yields[root] = f.read()
+
+        self.assertEqual(yields['files'], yields['files/friends'])
+
     def test_blinded(self):
         configuration = get_configuration()
         configuration['plots']['histo1']['blinded-range'] = [3, 5.2]
@@ -420,6 +585,44 @@ class plotItTestCase(plotItSimpleTestCase):
                 get_golden_file('default_configuration_multi_stacks_line_type.pdf')
                 )
 
+    def test_manifest(self):
+        input_folder = copy_input_files('files')
+
+        configuration = get_configuration()
+        configuration['configuration']['root'] = input_folder.name
+        configuration['plots'] = {'histo*': configuration['plots']['histo1']}
+        manifest = os.path.join(self.output_folder.name, 'plotIt_manifest.yml')
+
+        def run(args=[]):
+            for f in list_files(self.output_folder.name, '.pdf'):
+                os.remove(os.path.join(self.output_folder.name, f))
+
+            self.run_plotit(configuration, args)
+            return sorted(list_files(self.output_folder.name, '.pdf'))
+
+        # Directory listing, without the manifest
+        plots = run()
+        self.assertEqual(plots, ['histo1.pdf', 'histo2.pdf'])
+        self.assertFalse(os.path.exists(manifest))
+        reference = self.keep_output('histo1.pdf', 'histo1_reference.pdf')
+
+        # The first run with --cache records the content of the files, the second one only reads it
+        self.assertEqual(run(['--cache']), plots)
+        recorded = list_files(self.output_folder.name, '.yml')
+        self.assertIn('plotIt_manifest.yml', recorded)
+
+        self.assertEqual(run(['--cache']), plots)
+        self.assertEqual(list_files(self.output_folder.name, '.yml'), recorded)
+        self.compare_images(os.path.join(self.output_folder.name, 'histo1.pdf'), reference)
+
+        # Modified input files, which now only contain histo1: the manifest is rebuilt
+        for f in ['MC_sample1.root', 'MC_sample2.root', 'data.root']:
+            shutil.copy(os.path.join('files', 'trees', f), input_folder.name)
+            touch(os.path.join(input_folder.name, f))
+
+        self.assertEqual(run(['--cache']), ['histo1.pdf'])
+        self.assertNotEqual(list_files(self.output_folder.name, '.yml'), recorded)
+
     def test_eras(self):
         configuration = get_configuration()
 
@@ -439,3 +642,204 @@ class plotItTestCase(plotItSimpleTestCase):
                 os.path.join(self.output_folder.name, 'histo1.pdf'),
                 get_golden_file('default_configuration_eras.pdf')
                 )
+
+
+class plotItTreeTestCase(plotItSimpleTestCase):
+    """
+    Tree mode, on the files of generate_trees.C. Their histograms are filled with the values of
+    their trees, so the plots of tree mode are compared with the ones of histogram mode.
+    """
+
+    def run_histogram_mode(self):
+        self.run_plotit(get_tree_configuration(mode='histogram'))
+
+        return self.keep_output('histo1.pdf', 'histo1_histogram_mode.pdf')
+
+    def test_tree_filler(self):
+        self.run_internal_test('tree-filler')
+
+    def test_tree_mode(self):
+        reference = self.run_histogram_mode()
+
+        # All the plots are filled by the same loop over the trees
+        configuration = get_tree_configuration()
+        configuration['plots']['histo1_selected'] = dict(configuration['plots']['histo1'], **{'selection-string': 'value > 5'})
+
+        self.run_plotit(configuration)
+
+        self.assertTrue(os.path.exists(os.path.join(self.output_folder.name, 'histo1_selected.pdf')))
+        self.compare_images(os.path.join(self.output_folder.name, 'histo1.pdf'), reference)
+
+    def test_tree_mode_parallel(self):
+        reference = self.run_histogram_mode()
+
+        self.run_plotit(get_tree_configuration(), ['-j', '2'])
+        self.compare_images(os.path.join(self.output_folder.name, 'histo1.pdf'), reference)
+
+        self.run_plotit(get_tree_configuration(), ['-j', '2', '--compile-expressions'])
+        self.compare_images(os.path.join(self.output_folder.name, 'histo1.pdf'), reference)
+
+    def test_tree_filler_aliases(self):
+        self.run_internal_test('tree-filler-aliases')
+
+    def test_shared_selection(self):
+        self.run_internal_test('shared-selection')
+
+    def test_split_draw_string(self):
+        self.run_internal_test('split-draw-string')
+
+    def test_tree_filler_2d(self):
+        self.run_internal_test('tree-filler-2d')
+
+    def test_tree_mode_2d(self):
+        configuration = get_tree_configuration()
+        configuration['plots']['histo2d'] = {
+                'x-axis': "2 x value",
+                'y-axis': "value",
+                'draw-string': 'value:2 * value',
+                'binning-x': 40,
+                'binning-y': 20,
+                'x-axis-range': [0, 20],
+                'y-axis-range': [0, 10],
+                'save-extensions': ['pdf'],
+                }
+
+        self.run_plotit(configuration)
+
+        self.assertTrue(os.path.exists(os.path.join(self.output_folder.name, 'histo2d.pdf')))
+
+    def get_cached_tree_configuration(self):
+        """
+        Tree mode configuration on a copy of the input files, with a selection
+        """
+        self.input_folder = copy_input_files('files/trees')
+
+        configuration = get_tree_configuration()
+        configuration['configuration']['root'] = self.input_folder.name
+        configuration['plots']['histo1']['selection-string'] = 'value > 1'
+
+        return configuration
+
+    def test_histogram_cache(self):
+        configuration = self.get_cached_tree_configuration()
+        all_files = ['MC_sample1.root', 'MC_sample2.root', 'data.root']
+
+        output = self.run_plotit(configuration, ['--cache', '-v'])
+        self.assertEqual(get_read_files(output), all_files)
+        reference = self.keep_output('histo1.pdf', 'histo1_reference.pdf')
+
+        # All the histograms are cached: no file is read
+        output = self.run_plotit(configuration, ['--cache', '-v'])
+        self.assertEqual(get_read_files(output), [])
+        self.compare_images(os.path.join(self.output_folder.name, 'histo1.pdf'), reference)
+
+        # Formatting is not part of the key
+        configuration['plots']['histo1']['selection-string'] = '  value>1 '
+        output = self.run_plotit(configuration, ['--cache', '-v'])
+        self.assertEqual(get_read_files(output), [])
+
+        # Other selection, or other draw string
+        configuration['plots']['histo1']['selection-string'] = 'value > 2'
+        output = self.run_plotit(configuration, ['--cache', '-v'])
+        self.assertEqual(get_read_files(output), all_files)
+
+        configuration['plots']['histo1']['draw-string'] = 'value * 1'
+        output = self.run_plotit(configuration, ['--cache', '-v'])
+        self.assertEqual(get_read_files(output), all_files)
+
+        # Modified input file
+        touch(os.path.join(self.input_folder.name, 'MC_sample1.root'))
+        output = self.run_plotit(configuration, ['--cache', '-v'])
+        self.assertEqual(get_read_files(output), ['MC_sample1.root'])
+
+    def test_entry_list_cache(self):
+        configuration = self.get_cached_tree_configuration()
+        configuration['plots']['histo1']['selection-string'] = 'value > 5'
+        entry_lists = os.path.join(self.output_folder.name, 'plotIt_entrylists')
+
+        self.run_plotit(configuration, ['--cache'])
+        lists = list_files(entry_lists, '.entries')
+        self.assertEqual(len(lists), 3)
+
+        # Not in the histogram cache, but with the same selection: the files are read again,
+        # using the entry lists of the first run
+        configuration['plots']['histo1']['draw-string'] = 'value * 1'
+        output = self.run_plotit(configuration, ['--cache', '-v'])
+        self.assertEqual(get_read_files(output), ['MC_sample1.root', 'MC_sample2.root', 'data.root'])
+        self.assertEqual(list_files(entry_lists, '.entries'), lists)
+        cached = self.keep_output('histo1.pdf', 'histo1_cached.pdf')
+
+        self.run_plotit(configuration)
+        self.compare_images(os.path.join(self.output_folder.name, 'histo1.pdf'), cached)
+
+        # Modified input file: its entry list is recorded again, under a new key
+        touch(os.path.join(self.input_folder.name, 'MC_sample1.root'))
+        self.run_plotit(configuration, ['--cache'])
+
+        new_lists = list_files(entry_lists, '.entries')
+        self.assertEqual(len(new_lists), 4)
+        self.assertTrue(set(lists.items()) < set(new_lists.items()))
+
+    def test_preview(self):
+        configuration = get_tree_configuration()
+
+        output = self.run_plotit(configuration, ['-y', '-v'])
+        full_bytes = get_read_bytes(output)
+        full_yields = get_yields(self.output_folder.name, 'histo1')
+
+        # Only the first clusters of each tree are read, and the histograms are scaled back
+        output = self.run_plotit(configuration, ['-y', '-v', '--preview', '0.3'])
+        preview_bytes = get_read_bytes(output)
+        preview_yields = get_yields(self.output_folder.name, 'histo1')
+
+        self.assertEqual(sorted(preview_bytes), ['MC_sample1.root', 'MC_sample2.root', 'data.root'])
+        for f, mb in preview_bytes.items():
+            self.assertLess(mb, full_bytes[f])
+
+        self.assertEqual(len(preview_yields), len(full_yields))
+        self.assertTrue(full_yields)
+        for preview_yield, full_yield in zip(preview_yields, full_yields):
+            self.assertAlmostEqual(preview_yield, full_yield, delta=0.01 * full_yield)
+
+    def test_unary_operators(self):
+        # Whitespaces separate the two operators: 'value - -1' is not 'value--1'
+        configuration = get_tree_configuration()
+        configuration['plots']['histo1']['draw-string'] = 'value - -1'
+        configuration['plots']['histo1']['x-axis-range'] = [1, 11]
+
+        self.run_plotit(configuration)
+        self.assertTrue(os.path.exists(os.path.join(self.output_folder.name, 'histo1.pdf')))
+
+
+class plotItInternalsTestCase(plotItSimpleTestCase):
+    def test_glob_matcher(self):
+        self.run_internal_test('glob-matcher')
+
+    def test_histogram_store(self):
+        self.run_internal_test('histogram-store')
+
+    def test_pack(self):
+        configuration = get_configuration()
+        configuration['plots']['histo1']['show-ratio'] = True
+
+        pack_folder = TemporaryFolder()
+
+        with tempfile.NamedTemporaryFile() as yml:
+            yml.write(yaml.dump(configuration, encoding='utf-8'))
+            yml.flush()
+            with open(os.devnull, 'w+b') as null:
+                subprocess.check_call(['../plotIt-pack', yml.name, '-o', pack_folder.name], stdout=null)
+
+        # Same plot as from the ROOT files
+        self.run_plotit(configuration, ['--pack-dir', pack_folder.name])
+
+        self.compare_images(
+                os.path.join(self.output_folder.name, 'histo1.pdf'),
+                get_golden_file('default_configuration_ratio.pdf')
+                )
+
+    def test_systematic_set(self):
+        self.run_internal_test('systematic-set')
+
+    def test_kernels(self):
+        self.run_internal_test('kernels')